@@ -0,0 +1,23 @@
+#include "bench_utils.h"
+#include <time.h>
+
+double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+uint64_t next_random(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+double next_uniform(uint64_t *state)
+{
+    // the top 53 bits fill the mantissa of a double
+    return (next_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
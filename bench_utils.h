@@ -0,0 +1,24 @@
+#ifndef _BENCH_UTILS_H_
+#define _BENCH_UTILS_H_
+
+#include <stdint.h>
+
+/**
+ * @return seconds of a monotonic clock, for measuring durations
+ */
+double now_seconds(void);
+
+/**
+ * xorshift64, so generated inputs don't consume rand() numbers.
+ * @param state nonzero state, updated
+ * @return the next random number
+ */
+uint64_t next_random(uint64_t *state);
+
+/**
+ * @param state state of next_random()
+ * @return a random number uniform in [0, 1)
+ */
+double next_uniform(uint64_t *state);
+
+#endif //_BENCH_UTILS_H_
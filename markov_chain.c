@@ -103,6 +103,75 @@ int add_node_to_frequency_list(MarkovNode* first_node, MarkovNode* second_node,
     return EXIT_SUCCESS;
 }
 
+int init_dense_chain(DenseMarkovChain* dense_chain, void* states,
+                     const size_t state_size, const int size)
+{
+    dense_chain->nodes = malloc(size * sizeof(MarkovNode));
+    if (dense_chain->nodes == NULL)
+    {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        dense_chain->size = 0;
+        return EXIT_FAILURE;
+    }
+    dense_chain->size = size;
+    for (int i = 0; i < size; i++)
+    {
+        dense_chain->nodes[i] = (MarkovNode){
+            (char*)states + i * state_size, NULL, 0
+        };
+    }
+    return EXIT_SUCCESS;
+}
+
+int add_dense_transition(DenseMarkovChain* dense_chain, const int from,
+                         const int to)
+{
+    MarkovNode* first_node = &dense_chain->nodes[from];
+    MarkovNode* second_node = &dense_chain->nodes[to];
+    // States are identified by their index, no need to compare the data
+    for (int i = 0; i < first_node->frequency_count; i++)
+    {
+        if (first_node->frequency_list[i].markov_node == second_node)
+        {
+            first_node->frequency_list[i].frequency++;
+            return EXIT_SUCCESS;
+        }
+    }
+    // The list grows in powers of two, so it is full only when the count
+    // is 0 or a power of two
+    const int count = first_node->frequency_count;
+    if ((count & (count - 1)) == 0)
+    {
+        const int capacity = count == 0 ? 1 : 2 * count;
+        MarkovNodeFrequency* temp = realloc(first_node->frequency_list,
+                                            capacity * sizeof(MarkovNodeFrequency));
+        if (temp == NULL)
+        {
+            printf(ALLOCATION_ERROR_MASSAGE);
+            return EXIT_FAILURE;
+        }
+        first_node->frequency_list = temp;
+    }
+    first_node->frequency_list[count] = (MarkovNodeFrequency){second_node, 1};
+    first_node->frequency_count++;
+    return EXIT_SUCCESS;
+}
+
+void free_dense_chain(DenseMarkovChain* dense_chain)
+{
+    if (dense_chain == NULL || dense_chain->nodes == NULL)
+    {
+        return;
+    }
+    for (int i = 0; i < dense_chain->size; i++)
+    {
+        free(dense_chain->nodes[i].frequency_list);
+    }
+    free(dense_chain->nodes);
+    dense_chain->nodes = NULL;
+    dense_chain->size = 0;
+}
+
 void free_markov_chain(MarkovChain** ptr_chain)
 {
     // If the database is NULL, there is nothing to free
@@ -170,6 +239,10 @@ MarkovNode* get_next_random_node(MarkovNode* cur_markov_node)
     {
         total_words += cur_markov_node->frequency_list[i].frequency;
     }
+    if (total_words == 0)
+    {
+        return NULL;
+    }
     int word_index = get_random_number(total_words);
     for (int i = 0; i < cur_markov_node->frequency_count; i++)
     {
@@ -191,6 +264,10 @@ void generate_random_sequence(MarkovChain* markov_chain,
     for (int i = 0; i < max_length - 1; i++)
     {
         MarkovNode* next_node = get_next_random_node(curr_node);
+        if (next_node == NULL)
+        {
+            break;
+        }
         void* next_word = next_node->data;
         markov_chain->print_func_ptr(next_word);
         if (markov_chain->is_last_ptr(next_word))
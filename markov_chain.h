@@ -68,6 +68,16 @@ typedef struct MarkovChain {
     is_last is_last_ptr;
 } MarkovChain;
 
+/**
+ * Markov chain whose states are the integers 0..size-1. The node of state i
+ * is nodes[i], so states are reached by index instead of by a lookup in a
+ * database. The data of the nodes is borrowed from the caller.
+ */
+typedef struct DenseMarkovChain {
+    MarkovNode *nodes;
+    int size;
+} DenseMarkovChain;
+
 /**
  * Get one random state from the given markov_chain's database.
  * @param markov_chain
@@ -78,13 +88,15 @@ MarkovNode* get_first_random_node(MarkovChain *markov_chain);
 /**
  * Choose randomly the next state, depend on it's occurrence frequency.
  * @param cur_markov_node MarkovNode to choose from
- * @return MarkovNode of the chosen state
+ * @return MarkovNode of the chosen state, or NULL if cur_markov_node has no
+ * successors
  */
 MarkovNode* get_next_random_node(MarkovNode *cur_markov_node);
 
 /**
  * Receive markov_chain, generate and print random sequences out of it. The
- * sequence most have at least 2 words in it.
+ * sequence most have at least 2 words in it. It ends early at a state that
+ * has no successors.
  * @param markov_chain
  * @param first_node markov_node to start with, if NULL- choose a random markov_node
  * @param  max_length maximum length of chain to generate
@@ -129,6 +141,37 @@ Node* get_node_from_database(MarkovChain *markov_chain, void *data_ptr);
  */
 Node* add_to_database(MarkovChain *markov_chain, void *data_ptr);
 
+/**
+ * Allocate the nodes of a dense chain. The data of node i is the i-th
+ * element of states.
+ * @param dense_chain chain to initialize
+ * @param states contiguous array of size states, owned by the caller
+ * @param state_size size in bytes of a single state
+ * @param size number of states
+ * @return success/failure: 0 if the process was successful, 1 if in
+ * case of allocation error.
+ */
+int init_dense_chain(DenseMarkovChain *dense_chain, void *states,
+                     size_t state_size, int size);
+
+/**
+ * Add state to to the frequency list of state from. If already in list,
+ * update it's frequency value.
+ * @param dense_chain
+ * @param from index of the first state
+ * @param to index of the second state
+ * @return success/failure: 0 if the process was successful, 1 if in
+ * case of allocation error.
+ */
+int add_dense_transition(DenseMarkovChain *dense_chain, int from, int to);
+
+/**
+ * Free the nodes of a dense chain and their frequency lists. The states
+ * themselves are left to the caller.
+ * @param dense_chain chain to free
+ */
+void free_dense_chain(DenseMarkovChain *dense_chain);
+
 void print_word(void *word);
 
 int comp_words(void *first_word, void *second_word);
@@ -0,0 +1,478 @@
+#include "markov_csr.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GOLDEN_RATIO 0x9E3779B97F4A7C15ULL
+#define HASH_SHIFT 32
+
+/**
+ * Index of a node of the database, sorted by address to find successors.
+ */
+typedef struct NodeIndex {
+    const MarkovNode *node;
+    int index;
+} NodeIndex;
+
+static int comp_node_index(const void *first, const void *second)
+{
+    const MarkovNode *first_node = ((const NodeIndex*)first)->node;
+    const MarkovNode *second_node = ((const NodeIndex*)second)->node;
+    return (first_node > second_node) - (first_node < second_node);
+}
+
+static int comp_edges(const void *first, const void *second)
+{
+    return ((const CsrEdge*)first)->successor -
+           ((const CsrEdge*)second)->successor;
+}
+
+/**
+ * Heavier transitions first, ties by successor.
+ */
+static int comp_edges_by_frequency(const void *first, const void *second)
+{
+    const CsrEdge *first_edge = first;
+    const CsrEdge *second_edge = second;
+    if (first_edge->frequency != second_edge->frequency)
+    {
+        return second_edge->frequency - first_edge->frequency;
+    }
+    return first_edge->successor - second_edge->successor;
+}
+
+/**
+ * A state and the frequency of all transitions into and out of it.
+ */
+typedef struct StateHotness {
+    long hotness;
+    int state;
+} StateHotness;
+
+static int comp_hotness(const void *first, const void *second)
+{
+    const StateHotness *first_state = first;
+    const StateHotness *second_state = second;
+    if (first_state->hotness != second_state->hotness)
+    {
+        return (first_state->hotness < second_state->hotness) -
+               (first_state->hotness > second_state->hotness);
+    }
+    return first_state->state - second_state->state;
+}
+
+static int find_node_index(const NodeIndex *indices, const int size,
+                           const MarkovNode *node)
+{
+    const NodeIndex key = {node, 0};
+    const NodeIndex *found = bsearch(&key, indices, size, sizeof(NodeIndex),
+                                     comp_node_index);
+    return found->index;
+}
+
+int build_csr_chain(MarkovChain *markov_chain, CsrMarkovChain *csr_chain)
+{
+    const int size = markov_chain->database->size;
+    *csr_chain = (CsrMarkovChain){
+        0, NULL, NULL, NULL, NULL, NULL, markov_chain->free_data_ptr
+    };
+    csr_chain->data = calloc(size, sizeof(void*));
+    csr_chain->is_last = malloc(size * sizeof(bool));
+    csr_chain->offsets = malloc((size + 1) * sizeof(int));
+    csr_chain->totals = malloc(size * sizeof(long));
+    NodeIndex *indices = malloc(size * sizeof(NodeIndex));
+    if (csr_chain->data == NULL || csr_chain->is_last == NULL ||
+        csr_chain->offsets == NULL || csr_chain->totals == NULL ||
+        indices == NULL)
+    {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        free(indices);
+        free_csr_chain(csr_chain);
+        return EXIT_FAILURE;
+    }
+    csr_chain->size = size;
+    // first pass: number the nodes and count their transitions
+    csr_chain->offsets[0] = 0;
+    int i = 0;
+    for (const Node *curr = markov_chain->database->first; curr != NULL;
+         curr = curr->next, i++)
+    {
+        indices[i] = (NodeIndex){curr->data, i};
+        csr_chain->offsets[i + 1] = csr_chain->offsets[i] +
+                                    curr->data->frequency_count;
+    }
+    qsort(indices, size, sizeof(NodeIndex), comp_node_index);
+    // one extra edge so an empty chain still gets a valid pointer
+    csr_chain->edges = malloc((csr_chain->offsets[size] + 1) * sizeof(CsrEdge));
+    if (csr_chain->edges == NULL)
+    {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        free(indices);
+        free_csr_chain(csr_chain);
+        return EXIT_FAILURE;
+    }
+    // second pass: copy the data and the transitions
+    i = 0;
+    for (const Node *curr = markov_chain->database->first; curr != NULL;
+         curr = curr->next, i++)
+    {
+        const MarkovNode *markov_node = curr->data;
+        csr_chain->data[i] = markov_chain->copy_func_ptr(markov_node->data);
+        if (csr_chain->data[i] == NULL)
+        {
+            free(indices);
+            free_csr_chain(csr_chain);
+            return EXIT_FAILURE;
+        }
+        csr_chain->is_last[i] = markov_chain->is_last_ptr(markov_node->data);
+        CsrEdge *edges = csr_chain->edges + csr_chain->offsets[i];
+        long total = 0;
+        for (int j = 0; j < markov_node->frequency_count; j++)
+        {
+            const MarkovNodeFrequency *freq = &markov_node->frequency_list[j];
+            edges[j] = (CsrEdge){
+                find_node_index(indices, size, freq->markov_node),
+                freq->frequency
+            };
+            total += freq->frequency;
+        }
+        qsort(edges, markov_node->frequency_count, sizeof(CsrEdge),
+              comp_edges);
+        csr_chain->totals[i] = total;
+    }
+    free(indices);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Number the states in breadth first order, starting from the hottest
+ * state not numbered yet. Transitions must already be sorted by
+ * descending frequency.
+ * @param csr_chain
+ * @param order filled with the old number of every new state
+ * @param new_numbers filled with the new number of every old state
+ * @param seeds room for the hotness of every state
+ */
+static void number_by_hotness(const CsrMarkovChain *csr_chain, int *order,
+                              int *new_numbers, StateHotness *seeds)
+{
+    const int size = csr_chain->size;
+    for (int i = 0; i < size; i++)
+    {
+        seeds[i] = (StateHotness){csr_chain->totals[i], i};
+        new_numbers[i] = -1;
+    }
+    for (int j = 0; j < csr_chain->offsets[size]; j++)
+    {
+        const CsrEdge *edge = &csr_chain->edges[j];
+        seeds[edge->successor].hotness += edge->frequency;
+    }
+    qsort(seeds, size, sizeof(StateHotness), comp_hotness);
+    // order doubles as the queue of the breadth first search
+    int head = 0, tail = 0;
+    for (int i = 0; i < size; i++)
+    {
+        if (new_numbers[seeds[i].state] != -1)
+        {
+            continue;
+        }
+        new_numbers[seeds[i].state] = tail;
+        order[tail++] = seeds[i].state;
+        while (head < tail)
+        {
+            const int state = order[head++];
+            for (int j = csr_chain->offsets[state];
+                 j < csr_chain->offsets[state + 1]; j++)
+            {
+                const int successor = csr_chain->edges[j].successor;
+                if (new_numbers[successor] == -1)
+                {
+                    new_numbers[successor] = tail;
+                    order[tail++] = successor;
+                }
+            }
+        }
+    }
+}
+
+int relayout_csr_chain(CsrMarkovChain *csr_chain)
+{
+    const int size = csr_chain->size;
+    const int edge_count = csr_chain->offsets[size];
+    // allocate everything first, so on failure the chain is left untouched
+    int *order = malloc(size * sizeof(int));
+    int *new_numbers = malloc(size * sizeof(int));
+    StateHotness *seeds = malloc(size * sizeof(StateHotness));
+    CsrMarkovChain relaid = {
+        size, malloc(size * sizeof(void*)), malloc(size * sizeof(bool)),
+        malloc((size + 1) * sizeof(int)),
+        malloc((edge_count + 1) * sizeof(CsrEdge)),
+        malloc(size * sizeof(long)), csr_chain->free_data_ptr
+    };
+    if (order == NULL || new_numbers == NULL || seeds == NULL ||
+        relaid.data == NULL || relaid.is_last == NULL ||
+        relaid.offsets == NULL || relaid.edges == NULL ||
+        relaid.totals == NULL)
+    {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        free(order);
+        free(new_numbers);
+        free(seeds);
+        free(relaid.data);
+        free(relaid.is_last);
+        free(relaid.offsets);
+        free(relaid.edges);
+        free(relaid.totals);
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < size; i++)
+    {
+        qsort(csr_chain->edges + csr_chain->offsets[i],
+              csr_chain->offsets[i + 1] - csr_chain->offsets[i],
+              sizeof(CsrEdge), comp_edges_by_frequency);
+    }
+    number_by_hotness(csr_chain, order, new_numbers, seeds);
+    free(seeds);
+    relaid.offsets[0] = 0;
+    for (int i = 0; i < size; i++)
+    {
+        const int old = order[i];
+        relaid.data[i] = csr_chain->data[old];
+        relaid.is_last[i] = csr_chain->is_last[old];
+        relaid.totals[i] = csr_chain->totals[old];
+        int count = relaid.offsets[i];
+        for (int j = csr_chain->offsets[old]; j < csr_chain->offsets[old + 1];
+             j++, count++)
+        {
+            relaid.edges[count] = (CsrEdge){
+                new_numbers[csr_chain->edges[j].successor],
+                csr_chain->edges[j].frequency
+            };
+        }
+        relaid.offsets[i + 1] = count;
+    }
+    free(order);
+    free(new_numbers);
+    // the data moved to relaid, free only the old arrays
+    free(csr_chain->data);
+    free(csr_chain->is_last);
+    free(csr_chain->offsets);
+    free(csr_chain->edges);
+    free(csr_chain->totals);
+    *csr_chain = relaid;
+    return EXIT_SUCCESS;
+}
+
+int get_next_random_state(const CsrMarkovChain *csr_chain, const int state)
+{
+    const long total = csr_chain->totals[state];
+    if (total == 0)
+    {
+        return -1;
+    }
+    long index = rand() % total;
+    for (int j = csr_chain->offsets[state]; j < csr_chain->offsets[state + 1];
+         j++)
+    {
+        index -= csr_chain->edges[j].frequency;
+        if (index < 0)
+        {
+            return csr_chain->edges[j].successor;
+        }
+    }
+    return -1;
+}
+
+int write_csr_header(FILE *fp, const int size, const int edge_count)
+{
+    const int counts[] = {size, edge_count};
+    if (fwrite(CSR_MAGIC, 1, CSR_MAGIC_SIZE, fp) != CSR_MAGIC_SIZE ||
+        fwrite(counts, sizeof(int), 2, fp) != 2)
+    {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int write_csr_states(FILE *fp, char *const *words, const bool *is_last,
+                     const int size)
+{
+    for (int i = 0; i < size; i++)
+    {
+        const int length = strlen(words[i]);
+        if (fwrite(&length, sizeof(int), 1, fp) != 1 ||
+            fwrite(words[i], 1, length, fp) != (size_t)length)
+        {
+            return EXIT_FAILURE;
+        }
+    }
+    for (int i = 0; i < size; i++)
+    {
+        const unsigned char flag = is_last[i];
+        if (fwrite(&flag, 1, 1, fp) != 1)
+        {
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+int write_csr_chain(FILE *fp, const CsrMarkovChain *csr_chain)
+{
+    const int size = csr_chain->size;
+    const size_t edge_count = csr_chain->offsets[size];
+    if (write_csr_header(fp, size, edge_count) == EXIT_FAILURE ||
+        write_csr_states(fp, (char *const*)csr_chain->data,
+                         csr_chain->is_last, size) == EXIT_FAILURE ||
+        fwrite(csr_chain->edges, sizeof(CsrEdge), edge_count,
+               fp) != edge_count ||
+        fwrite(csr_chain->offsets, sizeof(int), size + 1,
+               fp) != (size_t)size + 1)
+    {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Read the words and transitions of a model file into csr_chain, whose
+ * counts are already set.
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int read_csr_body(FILE *fp, CsrMarkovChain *csr_chain,
+                         const int edge_count)
+{
+    const int size = csr_chain->size;
+    for (int i = 0; i < size; i++)
+    {
+        int length;
+        if (fread(&length, sizeof(int), 1, fp) != 1 || length < 0 ||
+            length == INT_MAX)
+        {
+            return EXIT_FAILURE;
+        }
+        char *word = malloc(length + 1);
+        if (word == NULL)
+        {
+            return EXIT_FAILURE;
+        }
+        csr_chain->data[i] = word;
+        if (fread(word, 1, length, fp) != (size_t)length)
+        {
+            return EXIT_FAILURE;
+        }
+        word[length] = '\0';
+    }
+    for (int i = 0; i < size; i++)
+    {
+        unsigned char flag;
+        if (fread(&flag, 1, 1, fp) != 1)
+        {
+            return EXIT_FAILURE;
+        }
+        csr_chain->is_last[i] = flag;
+    }
+    if (fread(csr_chain->edges, sizeof(CsrEdge), edge_count,
+              fp) != (size_t)edge_count ||
+        fread(csr_chain->offsets, sizeof(int), size + 1,
+              fp) != (size_t)size + 1 ||
+        csr_chain->offsets[0] != 0 || csr_chain->offsets[size] != edge_count)
+    {
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < size; i++)
+    {
+        if (csr_chain->offsets[i + 1] < csr_chain->offsets[i])
+        {
+            return EXIT_FAILURE;
+        }
+        long total = 0;
+        for (int j = csr_chain->offsets[i]; j < csr_chain->offsets[i + 1]; j++)
+        {
+            const CsrEdge *edge = &csr_chain->edges[j];
+            // a transition that never happened would break sampling
+            if (edge->successor < 0 || edge->successor >= size ||
+                edge->frequency <= 0)
+            {
+                return EXIT_FAILURE;
+            }
+            total += edge->frequency;
+        }
+        csr_chain->totals[i] = total;
+    }
+    return EXIT_SUCCESS;
+}
+
+int read_csr_chain(FILE *fp, CsrMarkovChain *csr_chain)
+{
+    *csr_chain = (CsrMarkovChain){0, NULL, NULL, NULL, NULL, NULL, free};
+    char magic[CSR_MAGIC_SIZE];
+    int counts[2];
+    if (fread(magic, 1, CSR_MAGIC_SIZE, fp) != CSR_MAGIC_SIZE ||
+        memcmp(magic, CSR_MAGIC, CSR_MAGIC_SIZE) != 0 ||
+        fread(counts, sizeof(int), 2, fp) != 2 || counts[0] < 0 ||
+        counts[1] < 0 || counts[0] == INT_MAX || counts[1] == INT_MAX)
+    {
+        printf(MODEL_FILE_ERROR);
+        return EXIT_FAILURE;
+    }
+    const int size = counts[0];
+    const int edge_count = counts[1];
+    csr_chain->data = calloc(size, sizeof(void*));
+    csr_chain->is_last = malloc(size * sizeof(bool));
+    csr_chain->offsets = malloc((size + 1) * sizeof(int));
+    csr_chain->edges = malloc((edge_count + 1) * sizeof(CsrEdge));
+    csr_chain->totals = malloc(size * sizeof(long));
+    if (csr_chain->data == NULL || csr_chain->is_last == NULL ||
+        csr_chain->offsets == NULL || csr_chain->edges == NULL ||
+        csr_chain->totals == NULL)
+    {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        free_csr_chain(csr_chain);
+        return EXIT_FAILURE;
+    }
+    csr_chain->size = size;
+    if (read_csr_body(fp, csr_chain, edge_count) == EXIT_FAILURE)
+    {
+        printf(MODEL_FILE_ERROR);
+        free_csr_chain(csr_chain);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+uint64_t transition_key(const int prev, const int next)
+{
+    return ((uint64_t)(uint32_t)prev << HASH_SHIFT | (uint32_t)next) + 1;
+}
+
+size_t transition_slot(const uint64_t key, const size_t capacity)
+{
+    return (size_t)((key * GOLDEN_RATIO) >> HASH_SHIFT) & (capacity - 1);
+}
+
+void free_csr_chain(CsrMarkovChain *csr_chain)
+{
+    if (csr_chain == NULL)
+    {
+        return;
+    }
+    if (csr_chain->data != NULL)
+    {
+        for (int i = 0; i < csr_chain->size; i++)
+        {
+            if (csr_chain->data[i] != NULL)
+            {
+                csr_chain->free_data_ptr(csr_chain->data[i]);
+            }
+        }
+    }
+    free(csr_chain->data);
+    free(csr_chain->is_last);
+    free(csr_chain->offsets);
+    free(csr_chain->edges);
+    free(csr_chain->totals);
+    *csr_chain = (CsrMarkovChain){
+        0, NULL, NULL, NULL, NULL, NULL, csr_chain->free_data_ptr
+    };
+}
@@ -0,0 +1,138 @@
+#ifndef _MARKOV_CSR_H_
+#define _MARKOV_CSR_H_
+
+#include "markov_chain.h"
+#include <stdint.h> // For uint64_t
+
+#define CSR_MAGIC "MKCSR001"
+#define CSR_MAGIC_SIZE 8
+#define MODEL_FILE_ERROR "Error: invalid model file\n"
+
+/**
+ * A transition of a CsrMarkovChain.
+ */
+typedef struct CsrEdge {
+    int successor; // index of the next state
+    int frequency; // appearances of successor after the state owning the edge
+} CsrEdge;
+
+/**
+ * Read only, contiguous form of a finished MarkovChain. States are the
+ * integers 0..size-1 in the order they were added to the database, and the
+ * transitions of state i are edges[offsets[i]] .. edges[offsets[i + 1] - 1],
+ * sorted by successor. relayout_csr_chain() changes both orders.
+ */
+typedef struct CsrMarkovChain {
+    int size;
+    void **data;   // data of every state, owned by the chain
+    bool *is_last; // is_last_ptr of every state
+    int *offsets;  // size + 1 entries
+    CsrEdge *edges;
+    long *totals;  // sum of the frequencies of every state
+    free_data free_data_ptr;
+} CsrMarkovChain;
+
+/**
+ * Build the contiguous form of markov_chain. The data of every state is
+ * copied, so markov_chain may be freed afterwards.
+ * @param markov_chain chain to copy
+ * @param csr_chain chain to fill
+ * @return success/failure: 0 if the process was successful, 1 if in
+ * case of allocation error.
+ */
+int build_csr_chain(MarkovChain *markov_chain, CsrMarkovChain *csr_chain);
+
+/**
+ * Renumber the states so that states that follow each other in walks are
+ * close in memory, and sort the transitions of every state by descending
+ * frequency so get_next_random_state() stops early. States are numbered in
+ * breadth first order starting from the hottest ones (highest frequency in
+ * and out), always following the heaviest transition first.
+ * Numbers of states taken before the relayout are no longer valid. On
+ * allocation error the chain is left unchanged.
+ * @param csr_chain chain to relayout
+ * @return success/failure: 0 if the process was successful, 1 if in
+ * case of allocation error.
+ */
+int relayout_csr_chain(CsrMarkovChain *csr_chain);
+
+/**
+ * Choose randomly the next state, depend on it's occurrence frequency.
+ * @param csr_chain
+ * @param state state to choose from
+ * @return the chosen state, or -1 if state has no transitions
+ */
+int get_next_random_state(const CsrMarkovChain *csr_chain, int state);
+
+/*
+ * Binary model files hold a chain of words, in the byte order of the
+ * machine that wrote them:
+ *     CSR_MAGIC
+ *     int size, int edge_count
+ *     every word: int length, then its bytes (without '\0')
+ *     is_last of every word, one byte each
+ *     edge_count CsrEdge
+ *     size + 1 offsets, as int
+ */
+
+/**
+ * Write the header of a model file.
+ * @param fp file to write to
+ * @param size number of states
+ * @param edge_count number of transitions
+ * @return EXIT_SUCCESS or EXIT_FAILURE in case of a write error
+ */
+int write_csr_header(FILE *fp, int size, int edge_count);
+
+/**
+ * Write the words and their is_last flags, right after the header.
+ * @param fp file to write to
+ * @param words null terminated word of every state
+ * @param is_last is_last of every state
+ * @param size number of states
+ * @return EXIT_SUCCESS or EXIT_FAILURE in case of a write error
+ */
+int write_csr_states(FILE *fp, char *const *words, const bool *is_last,
+                     int size);
+
+/**
+ * Write a chain of words as a model file.
+ * @param fp file to write to
+ * @param csr_chain chain whose data are null terminated words
+ * @return EXIT_SUCCESS or EXIT_FAILURE in case of a write error
+ */
+int write_csr_chain(FILE *fp, const CsrMarkovChain *csr_chain);
+
+/**
+ * Read a model file written by write_csr_chain() or train_external().
+ * @param fp file to read from
+ * @param csr_chain chain to fill, its data are words freed with free()
+ * @return EXIT_SUCCESS or EXIT_FAILURE if the file is not valid or in case
+ * of allocation error
+ */
+int read_csr_chain(FILE *fp, CsrMarkovChain *csr_chain);
+
+/**
+ * Key of the transition prev -> next in a hash table of transitions, never
+ * 0 so that 0 can mark empty slots.
+ * @param prev first state
+ * @param next second state
+ * @return the key
+ */
+uint64_t transition_key(int prev, int next);
+
+/**
+ * Home slot of a transition key in a hash table of transitions.
+ * @param key key from transition_key()
+ * @param capacity number of slots, a power of two
+ * @return slot to start probing from
+ */
+size_t transition_slot(uint64_t key, size_t capacity);
+
+/**
+ * Free csr_chain and all of it's content from memory
+ * @param csr_chain chain to free
+ */
+void free_csr_chain(CsrMarkovChain *csr_chain);
+
+#endif //_MARKOV_CSR_H_
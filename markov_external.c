@@ -0,0 +1,514 @@
+#include "markov_external.h"
+#include "markov_csr.h"
+#include "tokenizer.h"
+#include "word_index.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_FAN_IN 64 // most runs merged at once
+#define NO_WORD (-1)
+#define SPILL_ERROR "Error: failed to write the model or a temporary file\n"
+
+/**
+ * A transition and the number of times it was seen.
+ */
+typedef struct Bigram {
+    int prev;
+    int next;
+    int count;
+} Bigram;
+
+/**
+ * A sorted run of bigrams inside a spill file, in bigrams.
+ */
+typedef struct Run {
+    long start;
+    long length;
+} Run;
+
+/**
+ * Temporary file holding sorted runs one after the other.
+ */
+typedef struct SpillFile {
+    FILE *file;
+    long length; // bigrams written so far
+    Run *runs;
+    size_t run_count;
+    size_t run_capacity;
+} SpillFile;
+
+/**
+ * Reads a single run through a buffer.
+ */
+typedef struct RunCursor {
+    FILE *file;
+    long position;  // next bigram of the run to read from the file
+    long remaining; // bigrams of the run not read from the file yet
+    Bigram *buffer;
+    size_t capacity;
+    size_t size;    // bigrams in buffer
+    size_t index;   // current bigram in buffer
+} RunCursor;
+
+/**
+ * Everything train_external() allocates, freed together.
+ */
+typedef struct ExternalTrainer {
+    Bigram *pairs;      // transition buffer, reused by the merges
+    size_t pairs_capacity;
+    WordIndex index;
+    bool *is_last;      // is_last of every word of index
+    int is_last_capacity;
+    SpillFile spill;
+    int *degrees;       // number of transitions of every word, then offsets
+    Tokenizer tokenizer;
+    bool tokenizer_ready;
+} ExternalTrainer;
+
+/**
+ * Receives merged bigrams in (prev, next) order.
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+typedef int (*bigram_sink)(void *context, const Bigram *bigram);
+
+/**
+ * Writes merged bigrams as the edges of a model file.
+ */
+typedef struct EdgeWriter {
+    FILE *output;
+    int *degrees;
+    long edge_count;
+} EdgeWriter;
+
+static int comp_bigrams(const void *first, const void *second)
+{
+    const Bigram *first_bigram = first;
+    const Bigram *second_bigram = second;
+    if (first_bigram->prev != second_bigram->prev)
+    {
+        return first_bigram->prev < second_bigram->prev ? -1 : 1;
+    }
+    if (first_bigram->next != second_bigram->next)
+    {
+        return first_bigram->next < second_bigram->next ? -1 : 1;
+    }
+    return 0;
+}
+
+static int init_spill(SpillFile *spill)
+{
+    *spill = (SpillFile){tmpfile(), 0, NULL, 0, 0};
+    return spill->file == NULL ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static void free_spill(SpillFile *spill)
+{
+    if (spill->file != NULL)
+    {
+        fclose(spill->file);
+    }
+    free(spill->runs);
+    *spill = (SpillFile){NULL, 0, NULL, 0, 0};
+}
+
+/**
+ * Append bigram to the end of spill, as part of the run being written.
+ */
+static int spill_bigram(void *context, const Bigram *bigram)
+{
+    SpillFile *spill = context;
+    if (fwrite(bigram, sizeof(Bigram), 1, spill->file) != 1)
+    {
+        return EXIT_FAILURE;
+    }
+    spill->length++;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Record the bigrams written since start as a run of spill.
+ */
+static int close_run(SpillFile *spill, const long start)
+{
+    if (spill->run_count == spill->run_capacity)
+    {
+        const size_t capacity = spill->run_capacity == 0
+                                    ? MAX_FAN_IN
+                                    : 2 * spill->run_capacity;
+        Run *temp = realloc(spill->runs, capacity * sizeof(Run));
+        if (temp == NULL)
+        {
+            return EXIT_FAILURE;
+        }
+        spill->runs = temp;
+        spill->run_capacity = capacity;
+    }
+    spill->runs[spill->run_count++] = (Run){start, spill->length - start};
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Sort and count the pairs of the buffer and write them as a new run.
+ */
+static int spill_pairs(Bigram *pairs, const size_t count, SpillFile *spill)
+{
+    qsort(pairs, count, sizeof(Bigram), comp_bigrams);
+    size_t unique = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (unique > 0 && comp_bigrams(&pairs[unique - 1], &pairs[i]) == 0)
+        {
+            pairs[unique - 1].count += pairs[i].count;
+        }
+        else
+        {
+            pairs[unique++] = pairs[i];
+        }
+    }
+    const long start = spill->length;
+    if (fwrite(pairs, sizeof(Bigram), unique, spill->file) != unique)
+    {
+        return EXIT_FAILURE;
+    }
+    spill->length += unique;
+    return close_run(spill, start);
+}
+
+/**
+ * Read the next part of a run into the cursor's buffer.
+ * @return true if the buffer holds bigrams, false if the run is done
+ */
+static bool refill_cursor(RunCursor *cursor)
+{
+    if (cursor->remaining == 0)
+    {
+        return false;
+    }
+    const size_t wanted = (size_t)cursor->remaining < cursor->capacity
+                              ? (size_t)cursor->remaining
+                              : cursor->capacity;
+    if (fseek(cursor->file, cursor->position * (long)sizeof(Bigram),
+              SEEK_SET) != 0)
+    {
+        return false;
+    }
+    cursor->size = fread(cursor->buffer, sizeof(Bigram), wanted, cursor->file);
+    cursor->index = 0;
+    cursor->position += cursor->size;
+    cursor->remaining = cursor->size == wanted ? cursor->remaining - wanted : 0;
+    return cursor->size > 0;
+}
+
+static const Bigram *cursor_bigram(const RunCursor *cursor)
+{
+    return &cursor->buffer[cursor->index];
+}
+
+/**
+ * Move a cursor to its next bigram.
+ * @return false if the run is done
+ */
+static bool advance_cursor(RunCursor *cursor)
+{
+    cursor->index++;
+    return cursor->index < cursor->size || refill_cursor(cursor);
+}
+
+/**
+ * Restore the min heap order of cursors below position i.
+ */
+static void sift_down(RunCursor **heap, const size_t size, size_t i)
+{
+    while (1)
+    {
+        size_t smallest = i;
+        const size_t left = 2 * i + 1, right = 2 * i + 2;
+        if (left < size && comp_bigrams(cursor_bigram(heap[left]),
+                                        cursor_bigram(heap[smallest])) < 0)
+        {
+            smallest = left;
+        }
+        if (right < size && comp_bigrams(cursor_bigram(heap[right]),
+                                         cursor_bigram(heap[smallest])) < 0)
+        {
+            smallest = right;
+        }
+        if (smallest == i)
+        {
+            return;
+        }
+        RunCursor *temp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = temp;
+        i = smallest;
+    }
+}
+
+/**
+ * Merge up to MAX_FAN_IN runs of file, adding up the counts of equal
+ * bigrams, and pass every merged bigram to sink.
+ * @param file spill file holding the runs
+ * @param runs runs to merge
+ * @param count number of runs
+ * @param memory buffer shared by the runs
+ * @param memory_size size of memory, in bigrams
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int merge_runs(FILE *file, const Run *runs, const size_t count,
+                      Bigram *memory, const size_t memory_size,
+                      const bigram_sink sink, void *context)
+{
+    RunCursor cursors[MAX_FAN_IN];
+    RunCursor *heap[MAX_FAN_IN];
+    size_t heap_size = 0;
+    const size_t capacity = memory_size / (count == 0 ? 1 : count);
+    for (size_t i = 0; i < count; i++)
+    {
+        cursors[i] = (RunCursor){
+            file, runs[i].start, runs[i].length, memory + i * capacity,
+            capacity, 0, 0
+        };
+        if (refill_cursor(&cursors[i]))
+        {
+            heap[heap_size++] = &cursors[i];
+        }
+    }
+    for (size_t i = heap_size; i-- > 0;)
+    {
+        sift_down(heap, heap_size, i);
+    }
+    Bigram pending = {NO_WORD, NO_WORD, 0};
+    while (heap_size > 0)
+    {
+        const Bigram *bigram = cursor_bigram(heap[0]);
+        if (pending.count > 0 && comp_bigrams(&pending, bigram) == 0)
+        {
+            pending.count += bigram->count;
+        }
+        else
+        {
+            if (pending.count > 0 && sink(context, &pending) == EXIT_FAILURE)
+            {
+                return EXIT_FAILURE;
+            }
+            pending = *bigram;
+        }
+        if (!advance_cursor(heap[0]))
+        {
+            heap[0] = heap[--heap_size];
+        }
+        sift_down(heap, heap_size, 0);
+    }
+    if (pending.count > 0 && sink(context, &pending) == EXIT_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Merge groups of MAX_FAN_IN runs into a new spill file until at most
+ * MAX_FAN_IN runs are left.
+ */
+static int reduce_runs(ExternalTrainer *trainer)
+{
+    while (trainer->spill.run_count > MAX_FAN_IN)
+    {
+        SpillFile merged;
+        if (init_spill(&merged) == EXIT_FAILURE)
+        {
+            return EXIT_FAILURE;
+        }
+        for (size_t i = 0; i < trainer->spill.run_count; i += MAX_FAN_IN)
+        {
+            const size_t left = trainer->spill.run_count - i;
+            const long start = merged.length;
+            if (merge_runs(trainer->spill.file, trainer->spill.runs + i,
+                           left < MAX_FAN_IN ? left : MAX_FAN_IN,
+                           trainer->pairs, trainer->pairs_capacity,
+                           spill_bigram, &merged) == EXIT_FAILURE ||
+                close_run(&merged, start) == EXIT_FAILURE)
+            {
+                free_spill(&merged);
+                return EXIT_FAILURE;
+            }
+        }
+        free_spill(&trainer->spill);
+        trainer->spill = merged;
+    }
+    return EXIT_SUCCESS;
+}
+
+static int write_edge(void *context, const Bigram *bigram)
+{
+    EdgeWriter *writer = context;
+    const CsrEdge edge = {bigram->next, bigram->count};
+    if (writer->edge_count == INT_MAX ||
+        fwrite(&edge, sizeof(CsrEdge), 1, writer->output) != 1)
+    {
+        return EXIT_FAILURE;
+    }
+    writer->degrees[bigram->prev]++;
+    writer->edge_count++;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Record the is_last flag of a word seen for the first time.
+ */
+static int add_word(ExternalTrainer *trainer, const int id, const bool is_last)
+{
+    if (id == trainer->is_last_capacity)
+    {
+        const int capacity = trainer->is_last_capacity == 0
+                                 ? TOKENIZER_BATCH
+                                 : 2 * trainer->is_last_capacity;
+        bool *temp = realloc(trainer->is_last, capacity * sizeof(bool));
+        if (temp == NULL)
+        {
+            return EXIT_FAILURE;
+        }
+        trainer->is_last = temp;
+        trainer->is_last_capacity = capacity;
+    }
+    trainer->is_last[id] = is_last;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Read the whole input, keeping the vocabulary in memory and spilling the
+ * transitions as sorted runs. Mirrors fill_database().
+ */
+static int spill_input(ExternalTrainer *trainer, FILE *input)
+{
+    if (tokenizer_init(&trainer->tokenizer, input,
+                       TOKENIZER_BUFFER_SIZE) == EXIT_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+    trainer->tokenizer_ready = true;
+    TokenSpan span;
+    int status;
+    int prev = NO_WORD;
+    size_t count = 0;
+    while ((status = tokenizer_next(&trainer->tokenizer, &span)) == TOKEN_FOUND)
+    {
+        const int known = trainer->index.count;
+        const int id = word_index_add(&trainer->index, span.start, span.length);
+        if (id == WORD_NOT_FOUND ||
+            (id == known && add_word(trainer, id, span.is_last) == EXIT_FAILURE))
+        {
+            return EXIT_FAILURE;
+        }
+        if (prev != NO_WORD)
+        {
+            trainer->pairs[count++] = (Bigram){prev, id, 1};
+            if (count == trainer->pairs_capacity)
+            {
+                if (spill_pairs(trainer->pairs, count,
+                                &trainer->spill) == EXIT_FAILURE)
+                {
+                    return EXIT_FAILURE;
+                }
+                count = 0;
+            }
+        }
+        // a word that ends a sentence has no transitions
+        prev = span.is_last ? NO_WORD : id;
+    }
+    if (status == TOKEN_ERROR)
+    {
+        return EXIT_FAILURE;
+    }
+    if (count > 0)
+    {
+        return spill_pairs(trainer->pairs, count, &trainer->spill);
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Write the model file: header, words, the merged runs as edges, offsets,
+ * and finally the real number of edges in the header.
+ */
+static int write_model(ExternalTrainer *trainer, FILE *output)
+{
+    const int size = trainer->index.count;
+    trainer->degrees = calloc(size + 1, sizeof(int));
+    if (trainer->degrees == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+    EdgeWriter writer = {output, trainer->degrees, 0};
+    if (write_csr_header(output, size, 0) == EXIT_FAILURE ||
+        write_csr_states(output, trainer->index.words, trainer->is_last,
+                         size) == EXIT_FAILURE ||
+        merge_runs(trainer->spill.file, trainer->spill.runs,
+                   trainer->spill.run_count, trainer->pairs,
+                   trainer->pairs_capacity, write_edge,
+                   &writer) == EXIT_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+    // turn the degrees into offsets, in place
+    int offset = 0;
+    for (int i = 0; i <= size; i++)
+    {
+        const int degree = trainer->degrees[i];
+        trainer->degrees[i] = offset;
+        offset += degree;
+    }
+    if (fwrite(trainer->degrees, sizeof(int), size + 1,
+               output) != (size_t)size + 1 ||
+        fseek(output, 0, SEEK_SET) != 0 ||
+        write_csr_header(output, size, writer.edge_count) == EXIT_FAILURE ||
+        fflush(output) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+static void free_trainer(ExternalTrainer *trainer)
+{
+    free(trainer->pairs);
+    free_word_index(&trainer->index);
+    free(trainer->is_last);
+    free_spill(&trainer->spill);
+    free(trainer->degrees);
+    if (trainer->tokenizer_ready)
+    {
+        tokenizer_free(&trainer->tokenizer);
+    }
+}
+
+int train_external(FILE *input, FILE *output, size_t memory_budget)
+{
+    if (memory_budget < MIN_MEMORY_BUDGET)
+    {
+        memory_budget = MIN_MEMORY_BUDGET;
+    }
+    ExternalTrainer trainer;
+    memset(&trainer, 0, sizeof(trainer));
+    trainer.pairs_capacity = memory_budget / sizeof(Bigram);
+    trainer.pairs = malloc(trainer.pairs_capacity * sizeof(Bigram));
+    if (trainer.pairs == NULL ||
+        init_word_index(&trainer.index, 0) == EXIT_FAILURE)
+    {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        free_trainer(&trainer);
+        return EXIT_FAILURE;
+    }
+    if (init_spill(&trainer.spill) == EXIT_FAILURE ||
+        spill_input(&trainer, input) == EXIT_FAILURE ||
+        reduce_runs(&trainer) == EXIT_FAILURE ||
+        write_model(&trainer, output) == EXIT_FAILURE)
+    {
+        printf(SPILL_ERROR);
+        free_trainer(&trainer);
+        return EXIT_FAILURE;
+    }
+    free_trainer(&trainer);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,25 @@
+#ifndef _MARKOV_EXTERNAL_H_
+#define _MARKOV_EXTERNAL_H_
+
+#include <stdio.h>  // For FILE
+#include <stddef.h> // For size_t
+
+#define MIN_MEMORY_BUDGET (64 * 1024)
+
+/**
+ * Train a chain of words on a text file that may be larger than memory, and
+ * write it as a model file (see markov_csr.h) without building the chain in
+ * memory. Every transition is buffered as a (prev, next) pair; when the
+ * buffer is full the pairs are sorted, counted and spilled to a temporary
+ * file as a sorted run, and the runs are merged at the end straight into
+ * the model file. The output is identical to fill_database() followed by
+ * build_csr_chain() and write_csr_chain().
+ * @param input text file to train on
+ * @param output seekable file to write the model to
+ * @param memory_budget bytes used for buffering transitions, at least
+ * MIN_MEMORY_BUDGET. The vocabulary is kept in memory on top of it.
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int train_external(FILE *input, FILE *output, size_t memory_budget);
+
+#endif //_MARKOV_EXTERNAL_H_
@@ -0,0 +1,420 @@
+#include "markov_reach.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define LOCAL_ATTEMPTS 8 // unconditioned picks tried before weighing them all
+#define FINISH_EPSILON 1e-12 // finish probabilities this close to 1 are 1
+
+static double random_uniform(void)
+{
+    return rand() / (RAND_MAX + 1.0);
+}
+
+/**
+ * Fill an alias table of count entries from their weights: every entry is
+ * kept with its keep and otherwise gives way to its alias, so choosing one
+ * by weight takes a single random number and lookup. Without any weight
+ * every entry gives way to NO_STATE_LEFT.
+ * @param weights the weights, overwritten
+ * @param pending room for count indices
+ */
+static void fill_alias_table(AliasEntry *entries, double *weights,
+                             const int count, int *pending)
+{
+    double sum = 0;
+    for (int i = 0; i < count; i++)
+    {
+        sum += weights[i];
+    }
+    // light entries are stacked from the start of pending, heavy from its end
+    int light = 0, heavy = count;
+    for (int i = 0; i < count; i++)
+    {
+        entries[i] = (AliasEntry){0, NO_STATE_LEFT};
+        weights[i] = sum > 0 ? weights[i] * count / sum : 0;
+        if (weights[i] < 1)
+        {
+            pending[light++] = i;
+        }
+        else
+        {
+            pending[--heavy] = i;
+        }
+    }
+    if (sum == 0)
+    {
+        return;
+    }
+    // fill up every light entry with a heavy one, which may turn light
+    while (light > 0 && heavy < count)
+    {
+        const int small = pending[--light];
+        const int large = pending[heavy];
+        entries[small] = (AliasEntry){(float)weights[small], large};
+        weights[large] -= 1 - weights[small];
+        if (weights[large] < 1)
+        {
+            heavy++;
+            pending[light++] = large;
+        }
+    }
+    // what is left is 1 up to rounding
+    for (int i = 0; i < light; i++)
+    {
+        entries[pending[i]] = (AliasEntry){1, pending[i]};
+    }
+    for (int i = heavy; i < count; i++)
+    {
+        entries[pending[i]] = (AliasEntry){1, pending[i]};
+    }
+}
+
+/**
+ * Choose an entry of an alias table: the whole part of a random position
+ * picks one, its fraction decides whether to keep it.
+ * @return the entry, or NO_STATE_LEFT if no entry has weight
+ */
+static int draw_alias_entry(const AliasEntry *entries, const int count)
+{
+    const double position = random_uniform() * count;
+    const int entry = (int)position;
+    return position - entry < entries[entry].keep ? entry
+                                                  : entries[entry].alias;
+}
+
+/**
+ * Mark the states that can reach a last state, walking the transitions
+ * backwards from all the last states at once.
+ */
+static int find_finishing_states(ReachTable *reach_table)
+{
+    const CsrMarkovChain *csr_chain = reach_table->csr_chain;
+    const int size = csr_chain->size;
+    const int edge_count = csr_chain->offsets[size];
+    int *in_offsets = calloc(size + 1, sizeof(int));
+    int *predecessors = malloc((edge_count + 1) * sizeof(int));
+    int *queue = malloc((size + 1) * sizeof(int));
+    if (in_offsets == NULL || predecessors == NULL || queue == NULL)
+    {
+        free(in_offsets);
+        free(predecessors);
+        free(queue);
+        return EXIT_FAILURE;
+    }
+    // in_offsets[i] is first the end of the range of i's predecessors
+    for (int j = 0; j < edge_count; j++)
+    {
+        in_offsets[csr_chain->edges[j].successor]++;
+    }
+    for (int i = 1; i < size; i++)
+    {
+        in_offsets[i] += in_offsets[i - 1];
+    }
+    in_offsets[size] = edge_count;
+    // fill every range from its end, so in_offsets ends up as the starts
+    for (int i = size - 1; i >= 0; i--)
+    {
+        for (int j = csr_chain->offsets[i]; j < csr_chain->offsets[i + 1]; j++)
+        {
+            predecessors[--in_offsets[csr_chain->edges[j].successor]] = i;
+        }
+    }
+    int head = 0, tail = 0;
+    for (int i = 0; i < size; i++)
+    {
+        reach_table->can_finish[i] = csr_chain->is_last[i];
+        if (csr_chain->is_last[i])
+        {
+            queue[tail++] = i;
+        }
+    }
+    while (head < tail)
+    {
+        const int state = queue[head++];
+        for (int j = in_offsets[state]; j < in_offsets[state + 1]; j++)
+        {
+            const int prev = predecessors[j];
+            if (!reach_table->can_finish[prev])
+            {
+                reach_table->can_finish[prev] = true;
+                queue[tail++] = prev;
+            }
+        }
+    }
+    free(in_offsets);
+    free(predecessors);
+    free(queue);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Fill the finish probabilities, one number of transitions after the other:
+ * a last state has ended, and any other state ends within k transitions
+ * with the average over its transitions of ending within k - 1.
+ */
+static void compute_finish(ReachTable *reach_table)
+{
+    const CsrMarkovChain *csr_chain = reach_table->csr_chain;
+    const int size = csr_chain->size;
+    for (int i = 0; i < size; i++)
+    {
+        reach_table->finish[i] = csr_chain->is_last[i] ? 1 : 0;
+    }
+    for (int k = 1; k < reach_table->max_length; k++)
+    {
+        const double *before = reach_table->finish + (size_t)(k - 1) * size;
+        double *current = reach_table->finish + (size_t)k * size;
+        for (int i = 0; i < size; i++)
+        {
+            if (csr_chain->is_last[i] || !reach_table->can_finish[i])
+            {
+                current[i] = before[i];
+                continue;
+            }
+            double sum = 0;
+            for (int j = csr_chain->offsets[i]; j < csr_chain->offsets[i + 1];
+                 j++)
+            {
+                sum += csr_chain->edges[j].frequency *
+                       before[csr_chain->edges[j].successor];
+            }
+            current[i] = sum / csr_chain->totals[i];
+        }
+    }
+}
+
+/**
+ * Collect the first states, weighted by the probability to end from them.
+ */
+static void collect_first_states(ReachTable *reach_table, double *weights,
+                                 int *pending)
+{
+    const CsrMarkovChain *csr_chain = reach_table->csr_chain;
+    const double *finish = reach_table->finish +
+                           (size_t)(reach_table->max_length - 1) *
+                           csr_chain->size;
+    reach_table->first_count = 0;
+    for (int i = 0; i < csr_chain->size; i++)
+    {
+        if (!csr_chain->is_last[i] && finish[i] > 0)
+        {
+            weights[reach_table->first_count] = finish[i];
+            reach_table->first_states[reach_table->first_count++] = i;
+        }
+    }
+    fill_alias_table(reach_table->first_alias, weights,
+                     reach_table->first_count, pending);
+}
+
+/**
+ * Fill the step tables from the finish probabilities, one alias table for
+ * the transitions of every state and number of transitions left.
+ */
+static void compute_step_tables(ReachTable *reach_table, double *weights,
+                                int *pending)
+{
+    const CsrMarkovChain *csr_chain = reach_table->csr_chain;
+    const int size = csr_chain->size;
+    const int edge_count = csr_chain->offsets[size];
+    for (int k = 1; k < reach_table->max_length; k++)
+    {
+        const double *before = reach_table->finish + (size_t)(k - 1) * size;
+        AliasEntry *table = reach_table->step_tables +
+                            (size_t)(k - 1) * edge_count;
+        for (int i = 0; i < size; i++)
+        {
+            const int start = csr_chain->offsets[i];
+            const int end = csr_chain->offsets[i + 1];
+            for (int j = start; j < end; j++)
+            {
+                weights[j - start] = csr_chain->edges[j].frequency *
+                                     before[csr_chain->edges[j].successor];
+            }
+            fill_alias_table(table + start, weights, end - start, pending);
+        }
+    }
+}
+
+int build_reach_table(ReachTable *reach_table, const CsrMarkovChain *csr_chain,
+                      const int max_length)
+{
+    const int size = csr_chain->size;
+    *reach_table = (ReachTable){
+        csr_chain, max_length < 2 ? 2 : max_length,
+        malloc((size + 1) * sizeof(bool)), NULL,
+        malloc((size + 1) * sizeof(int)),
+        malloc((size + 1) * sizeof(AliasEntry)), 0, NULL
+    };
+    reach_table->finish = malloc(
+        ((size_t)reach_table->max_length * size + 1) * sizeof(double));
+    const size_t step_entries = (size_t)(reach_table->max_length - 1) *
+                                csr_chain->offsets[size];
+    if (step_entries <= MAX_STEP_TABLES)
+    {
+        reach_table->step_tables = malloc(
+            (step_entries + 1) * sizeof(AliasEntry));
+    }
+    // room for the weights of the first states or of the transitions of
+    // any state, which read_csr_chain() doesn't bound by size
+    int most = size;
+    for (int i = 0; i < size; i++)
+    {
+        const int degree = csr_chain->offsets[i + 1] - csr_chain->offsets[i];
+        most = degree > most ? degree : most;
+    }
+    double *weights = malloc((most + 1) * sizeof(double));
+    int *pending = malloc((most + 1) * sizeof(int));
+    if ((step_entries <= MAX_STEP_TABLES &&
+         reach_table->step_tables == NULL) ||
+        reach_table->can_finish == NULL || reach_table->finish == NULL ||
+        reach_table->first_states == NULL ||
+        reach_table->first_alias == NULL || weights == NULL ||
+        pending == NULL || find_finishing_states(reach_table) == EXIT_FAILURE)
+    {
+        free(weights);
+        free(pending);
+        free_reach_table(reach_table);
+        return EXIT_FAILURE;
+    }
+    compute_finish(reach_table);
+    if (reach_table->step_tables != NULL)
+    {
+        compute_step_tables(reach_table, weights, pending);
+    }
+    collect_first_states(reach_table, weights, pending);
+    free(weights);
+    free(pending);
+    return EXIT_SUCCESS;
+}
+
+int get_first_finishing_state(const ReachTable *reach_table)
+{
+    if (reach_table->first_count == 0)
+    {
+        return NO_STATE_LEFT;
+    }
+    return reach_table->first_states[draw_alias_entry(
+        reach_table->first_alias, reach_table->first_count)];
+}
+
+/**
+ * get_next_finishing_state() without step tables.
+ */
+static int weigh_next_state(const ReachTable *reach_table, const int state,
+                            const double *finish)
+{
+    const CsrMarkovChain *csr_chain = reach_table->csr_chain;
+    const int start = csr_chain->offsets[state];
+    const int end = csr_chain->offsets[state + 1];
+    const long total = csr_chain->totals[state];
+    if (total == 0)
+    {
+        return NO_STATE_LEFT;
+    }
+    // keeping an unconditioned pick with the probability to end from it
+    // gives the same distribution, and usually succeeds at once. Where the
+    // random number falls inside the chosen transition is itself uniform,
+    // so it decides whether to keep it without drawing again. The scan
+    // itself counts in integers, like get_next_random_state().
+    for (int i = 0; i < LOCAL_ATTEMPTS; i++)
+    {
+        const double position = random_uniform() * total;
+        const long whole = (long)position;
+        long index = whole;
+        for (int j = start; j < end; j++)
+        {
+            const int frequency = csr_chain->edges[j].frequency;
+            if (index < frequency)
+            {
+                const int next = csr_chain->edges[j].successor;
+                if (finish[next] >= 1 - FINISH_EPSILON ||
+                    index + (position - whole) < finish[next] * frequency)
+                {
+                    return next;
+                }
+                break;
+            }
+            index -= frequency;
+        }
+    }
+    double sum = 0;
+    for (int j = start; j < end; j++)
+    {
+        sum += csr_chain->edges[j].frequency *
+               finish[csr_chain->edges[j].successor];
+    }
+    if (sum == 0)
+    {
+        return NO_STATE_LEFT;
+    }
+    double target = random_uniform() * sum;
+    int chosen = NO_STATE_LEFT;
+    for (int j = start; j < end; j++)
+    {
+        const double weight = csr_chain->edges[j].frequency *
+                              finish[csr_chain->edges[j].successor];
+        if (weight > 0)
+        {
+            chosen = csr_chain->edges[j].successor;
+            target -= weight;
+            if (target < 0)
+            {
+                break;
+            }
+        }
+    }
+    // rounding may leave target just above 0, keep the last possible state
+    return chosen;
+}
+
+int get_next_finishing_state(const ReachTable *reach_table, const int state,
+                             const int remaining)
+{
+    const CsrMarkovChain *csr_chain = reach_table->csr_chain;
+    if (reach_table->step_tables == NULL)
+    {
+        return weigh_next_state(reach_table, state,
+                                reach_table->finish +
+                                (size_t)(remaining - 1) * csr_chain->size);
+    }
+    const int start = csr_chain->offsets[state];
+    const int end = csr_chain->offsets[state + 1];
+    if (start == end)
+    {
+        return NO_STATE_LEFT;
+    }
+    const int entry = draw_alias_entry(
+        reach_table->step_tables +
+        (size_t)(remaining - 1) * csr_chain->offsets[csr_chain->size] + start,
+        end - start);
+    return entry == NO_STATE_LEFT ? NO_STATE_LEFT
+                                  : csr_chain->edges[start + entry].successor;
+}
+
+int generate_finishing_sequence(const ReachTable *reach_table, int *sequence)
+{
+    int state = get_first_finishing_state(reach_table);
+    if (state == NO_STATE_LEFT)
+    {
+        return 0;
+    }
+    int length = 0;
+    sequence[length++] = state;
+    while (!reach_table->csr_chain->is_last[state])
+    {
+        state = get_next_finishing_state(reach_table, state,
+                                         reach_table->max_length - length);
+        sequence[length++] = state;
+    }
+    return length;
+}
+
+void free_reach_table(ReachTable *reach_table)
+{
+    free(reach_table->can_finish);
+    free(reach_table->finish);
+    free(reach_table->first_states);
+    free(reach_table->first_alias);
+    free(reach_table->step_tables);
+    *reach_table = (ReachTable){NULL, 0, NULL, NULL, NULL, NULL, 0, NULL};
+}
@@ -0,0 +1,97 @@
+#ifndef _MARKOV_REACH_H_
+#define _MARKOV_REACH_H_
+
+#include "markov_csr.h"
+
+#define NO_STATE_LEFT (-1)
+// most entries of the per transition alias tables
+#define MAX_STEP_TABLES (1 << 24)
+
+/**
+ * Entry of an alias table, for choosing among weighted entries at once.
+ */
+typedef struct AliasEntry {
+    float keep; // probability to keep this entry
+    int alias;  // entry to take instead
+} AliasEntry;
+
+/**
+ * Which states of a CsrMarkovChain can still end a sequence, computed once
+ * the chain is finished. A sequence of at most max_length states, like the
+ * ones of generate_random_sequence(), starts at a state that is not last
+ * and takes at most max_length - 1 transitions to reach a last state.
+ */
+typedef struct ReachTable {
+    const CsrMarkovChain *csr_chain; // borrowed, must outlive the table
+    int max_length;
+    bool *can_finish; // whether a last state is reachable at all
+    double *finish;   // finish[k * size + s]: probability that a random walk
+                      // from s reaches a last state within k transitions,
+                      // for k = 0..max_length - 1
+    int *first_states;       // states a finishing sequence can start at
+    AliasEntry *first_alias; // alias table of them, weighted by the
+                             // probability to end from them
+    int first_count;
+    AliasEntry *step_tables; // step_tables[(k - 1) * edge_count + j]: alias
+                             // tables over the transitions of every state,
+                             // weighted by frequency times finish within
+                             // k - 1 transitions of the successor, for
+                             // k = 1..max_length - 1, or NULL if it would
+                             // exceed MAX_STEP_TABLES
+} ReachTable;
+
+/**
+ * Analyze csr_chain: find the states that can reach a last state by a
+ * breadth first search over the reversed transitions, then the probability
+ * of reaching one within every remaining number of transitions.
+ * @param reach_table table to fill
+ * @param csr_chain finished chain
+ * @param max_length maximum number of states in a sequence, at least 2
+ * @return success/failure: 0 if the process was successful, 1 if in
+ * case of allocation error.
+ */
+int build_reach_table(ReachTable *reach_table, const CsrMarkovChain *csr_chain,
+                      int max_length);
+
+/**
+ * Choose randomly a first state, depend on the probability of a sequence
+ * from it to end. Equals choosing a state that is not last uniformly and
+ * keeping it only if the sequence from it ends.
+ * @param reach_table
+ * @return the chosen state, or NO_STATE_LEFT if no sequence can end
+ */
+int get_first_finishing_state(const ReachTable *reach_table);
+
+/**
+ * Choose randomly the next state of a sequence that must end within
+ * remaining transitions: every successor is weighted by the frequency of
+ * its transition times the probability to end from it in time. Dead end
+ * successors are never chosen. Uses a single random number and a lookup
+ * in the step tables; without them tries a few unconditioned picks, kept
+ * with the probability to end from them, before weighing every successor.
+ * @param reach_table
+ * @param state state to choose from, able to end within remaining
+ * @param remaining transitions left, at least 1
+ * @return the chosen state, or NO_STATE_LEFT if state can't end in time
+ */
+int get_next_finishing_state(const ReachTable *reach_table, int state,
+                             int remaining);
+
+/**
+ * Generate a random sequence that ends at a last state, distributed like
+ * the sequences of get_first_random_node() and generate_random_sequence()
+ * that end at a last state.
+ * @param reach_table
+ * @param sequence array of max_length states to fill
+ * @return number of states in sequence, or 0 if no sequence can end
+ */
+int generate_finishing_sequence(const ReachTable *reach_table, int *sequence);
+
+/**
+ * Free reach_table and all of it's content from memory. The chain is left
+ * to the caller.
+ * @param reach_table table to free
+ */
+void free_reach_table(ReachTable *reach_table);
+
+#endif //_MARKOV_REACH_H_
@@ -0,0 +1,303 @@
+#include "markov_score.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_CAPACITY 16
+
+/**
+ * Running score of a sequence.
+ */
+typedef struct ScoreState {
+    SequenceScore score;
+    int prev;      // id of the previous word, WORD_NOT_FOUND if unknown
+    bool has_prev; // false at the start and after a word that ends a sentence
+} ScoreState;
+
+/**
+ * Lines scored by a single thread.
+ */
+typedef struct ScoreTask {
+    const ChainScorer *scorer;
+    const char *data;
+    const size_t *line_starts; // line i is data[line_starts[i]..line_starts[i + 1])
+    size_t first_line;
+    size_t last_line;          // one past the last line of the task
+    SequenceScore *scores;
+} ScoreTask;
+
+static int find_frequency(const ChainScorer *scorer, const int prev,
+                          const int next)
+{
+    const uint64_t key = transition_key(prev, next);
+    size_t slot = transition_slot(key, scorer->capacity);
+    while (scorer->keys[slot] != 0)
+    {
+        if (scorer->keys[slot] == key)
+        {
+            return scorer->frequencies[slot];
+        }
+        slot = (slot + 1) & (scorer->capacity - 1);
+    }
+    return 0;
+}
+
+int init_scorer(ChainScorer *scorer, const CsrMarkovChain *csr_chain,
+                const double alpha)
+{
+    *scorer = (ChainScorer){
+        csr_chain, {NULL, 0, NULL, 0, 0, NULL, 0, 0}, NULL, NULL, 0, alpha
+    };
+    // the scan used by the threads of score_lines is chosen here, once
+    tokenizer_active_isa();
+    if (init_word_index(&scorer->index, csr_chain->size) == EXIT_FAILURE)
+    {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < csr_chain->size; i++)
+    {
+        const char *word = csr_chain->data[i];
+        if (word_index_add(&scorer->index, word, strlen(word)) ==
+            WORD_NOT_FOUND)
+        {
+            printf(ALLOCATION_ERROR_MASSAGE);
+            free_scorer(scorer);
+            return EXIT_FAILURE;
+        }
+    }
+    // keep the transitions table at most half full
+    const size_t edges = csr_chain->offsets[csr_chain->size];
+    size_t capacity = MIN_CAPACITY;
+    while (capacity < 2 * edges)
+    {
+        capacity *= 2;
+    }
+    scorer->keys = calloc(capacity, sizeof(uint64_t));
+    scorer->frequencies = malloc(capacity * sizeof(int));
+    if (scorer->keys == NULL || scorer->frequencies == NULL)
+    {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        free_scorer(scorer);
+        return EXIT_FAILURE;
+    }
+    scorer->capacity = capacity;
+    for (int i = 0; i < csr_chain->size; i++)
+    {
+        for (int j = csr_chain->offsets[i]; j < csr_chain->offsets[i + 1]; j++)
+        {
+            const uint64_t key =
+                transition_key(i, csr_chain->edges[j].successor);
+            size_t slot = transition_slot(key, capacity);
+            while (scorer->keys[slot] != 0)
+            {
+                slot = (slot + 1) & (capacity - 1);
+            }
+            scorer->keys[slot] = key;
+            scorer->frequencies[slot] = csr_chain->edges[j].frequency;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Natural log of the smoothed probability of moving from prev to next.
+ */
+static double log_probability(const ChainScorer *scorer, const int prev,
+                              const int next)
+{
+    long total = 0;
+    int frequency = 0;
+    if (prev != WORD_NOT_FOUND)
+    {
+        total = scorer->csr_chain->totals[prev];
+        if (next != WORD_NOT_FOUND)
+        {
+            frequency = find_frequency(scorer, prev, next);
+        }
+    }
+    const double numerator = frequency + scorer->alpha;
+    if (numerator == 0)
+    {
+        return -INFINITY;
+    }
+    return log(numerator /
+               (total + scorer->alpha * scorer->csr_chain->size));
+}
+
+static void add_token(const ChainScorer *scorer, ScoreState *state,
+                      const TokenSpan *span)
+{
+    const int id = word_index_find(&scorer->index, span->start, span->length);
+    state->score.tokens++;
+    if (state->has_prev)
+    {
+        state->score.log_likelihood += log_probability(scorer, state->prev, id);
+        state->score.transitions++;
+    }
+    state->prev = id;
+    state->has_prev = !span->is_last;
+}
+
+static SequenceScore finish_score(ScoreState *state)
+{
+    SequenceScore score = state->score;
+    score.perplexity = score.transitions == 0
+                           ? 1
+                           : exp(-score.log_likelihood / score.transitions);
+    return score;
+}
+
+SequenceScore score_sequence(const ChainScorer *scorer, const TokenSpan *spans,
+                             const size_t count)
+{
+    ScoreState state = {{0, 0, 0, 0}, WORD_NOT_FOUND, false};
+    for (size_t i = 0; i < count; i++)
+    {
+        add_token(scorer, &state, &spans[i]);
+    }
+    return finish_score(&state);
+}
+
+/**
+ * Score [start, end) as a single sequence, tokenizing it in batches.
+ */
+static SequenceScore score_text(const ChainScorer *scorer, const char *start,
+                                const char *end)
+{
+    ScoreState state = {{0, 0, 0, 0}, WORD_NOT_FOUND, false};
+    TokenSpan spans[TOKENIZER_BATCH];
+    size_t count;
+    while ((count = scan_tokens(&start, end, spans, TOKENIZER_BATCH)) > 0)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            add_token(scorer, &state, &spans[i]);
+        }
+    }
+    return finish_score(&state);
+}
+
+static void *run_score_task(void *arg)
+{
+    const ScoreTask *task = arg;
+    for (size_t i = task->first_line; i < task->last_line; i++)
+    {
+        task->scores[i] = score_text(task->scorer,
+                                     task->data + task->line_starts[i],
+                                     task->data + task->line_starts[i + 1]);
+    }
+    return NULL;
+}
+
+/**
+ * Find where every line of data starts.
+ * @return newly allocated array of count + 1 offsets, the last one is size
+ */
+static size_t *find_line_starts(const char *data, const size_t size,
+                                size_t *count)
+{
+    size_t lines = 0;
+    for (const char *p = data; p < data + size; p++)
+    {
+        p = memchr(p, '\n', data + size - p);
+        if (p == NULL)
+        {
+            break;
+        }
+        lines++;
+    }
+    if (size > 0 && data[size - 1] != '\n')
+    {
+        lines++;
+    }
+    size_t *line_starts = malloc((lines + 1) * sizeof(size_t));
+    if (line_starts == NULL)
+    {
+        return NULL;
+    }
+    line_starts[0] = 0;
+    size_t line = 1;
+    for (const char *p = data; line < lines; p++)
+    {
+        p = memchr(p, '\n', data + size - p);
+        line_starts[line++] = p + 1 - data;
+    }
+    line_starts[lines] = size;
+    *count = lines;
+    return line_starts;
+}
+
+int score_lines(const ChainScorer *scorer, const char *data, const size_t size,
+                int threads, SequenceScore **scores, size_t *count)
+{
+    size_t lines = 0;
+    size_t *line_starts = find_line_starts(data, size, &lines);
+    SequenceScore *line_scores = malloc((lines + 1) * sizeof(SequenceScore));
+    if (threads < 1)
+    {
+        threads = 1;
+    }
+    if ((size_t)threads > lines)
+    {
+        threads = lines == 0 ? 1 : lines;
+    }
+    ScoreTask *tasks = malloc(threads * sizeof(ScoreTask));
+    pthread_t *ids = malloc(threads * sizeof(pthread_t));
+    bool *started = calloc(threads, sizeof(bool));
+    if (line_starts == NULL || line_scores == NULL || tasks == NULL ||
+        ids == NULL || started == NULL)
+    {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        free(line_starts);
+        free(line_scores);
+        free(tasks);
+        free(ids);
+        free(started);
+        return EXIT_FAILURE;
+    }
+    for (int t = 0; t < threads; t++)
+    {
+        tasks[t] = (ScoreTask){
+            scorer, data, line_starts, lines * t / threads,
+            lines * (t + 1) / threads, line_scores
+        };
+        // the first task runs on this thread, and so does any task whose
+        // thread could not be created
+        started[t] = t > 0 &&
+                     pthread_create(&ids[t], NULL, run_score_task,
+                                    &tasks[t]) == 0;
+    }
+    for (int t = 0; t < threads; t++)
+    {
+        if (!started[t])
+        {
+            run_score_task(&tasks[t]);
+        }
+    }
+    for (int t = 0; t < threads; t++)
+    {
+        if (started[t])
+        {
+            pthread_join(ids[t], NULL);
+        }
+    }
+    free(line_starts);
+    free(tasks);
+    free(ids);
+    free(started);
+    *scores = line_scores;
+    *count = lines;
+    return EXIT_SUCCESS;
+}
+
+void free_scorer(ChainScorer *scorer)
+{
+    free_word_index(&scorer->index);
+    free(scorer->keys);
+    free(scorer->frequencies);
+    scorer->keys = NULL;
+    scorer->frequencies = NULL;
+    scorer->capacity = 0;
+}
@@ -0,0 +1,77 @@
+#ifndef _MARKOV_SCORE_H_
+#define _MARKOV_SCORE_H_
+
+#include "markov_csr.h"
+#include "tokenizer.h"
+#include "word_index.h"
+#include <stdint.h>
+
+/**
+ * Scores word sequences by their likelihood under a chain of words.
+ * The probability of a transition from prev to next is
+ *     (frequency(prev, next) + alpha) / (total(prev) + alpha * size)
+ * so alpha = 0 gives unseen transitions a probability of 0 (and a
+ * log likelihood of -INFINITY), and alpha > 0 is additive smoothing.
+ * A scorer is read only once built, so many threads may share it.
+ */
+typedef struct ChainScorer {
+    const CsrMarkovChain *csr_chain; // chain of words, not owned
+    WordIndex index;                 // word of every state to its id
+    uint64_t *keys;                  // packed (prev, next) + 1, 0 if empty
+    int *frequencies;                // frequency of the transition in keys
+    size_t capacity;                 // number of keys, a power of two
+    double alpha;
+} ChainScorer;
+
+/**
+ * Score of a single sequence. Like in fill_database, a word that ends a
+ * sentence is not followed by a transition.
+ */
+typedef struct SequenceScore {
+    double log_likelihood; // natural log of the probability of the transitions
+    double perplexity;     // exp(-log_likelihood / transitions), 1 if none
+    int tokens;
+    int transitions;
+} SequenceScore;
+
+/**
+ * Build a scorer for a chain of words.
+ * @param scorer scorer to initialize
+ * @param csr_chain chain whose data are null terminated words, must outlive
+ * the scorer
+ * @param alpha smoothing added to every transition frequency, at least 0
+ * @return EXIT_SUCCESS or EXIT_FAILURE in case of allocation error
+ */
+int init_scorer(ChainScorer *scorer, const CsrMarkovChain *csr_chain,
+                double alpha);
+
+/**
+ * Score a tokenized sequence.
+ * @param scorer
+ * @param spans words of the sequence
+ * @param count number of words
+ * @return the score of the sequence
+ */
+SequenceScore score_sequence(const ChainScorer *scorer, const TokenSpan *spans,
+                             size_t count);
+
+/**
+ * Score every line of a text as a separate sequence.
+ * @param scorer
+ * @param data the text, not modified
+ * @param size size of the text in bytes
+ * @param threads number of threads to score with
+ * @param scores set to a newly allocated array with the score of every line
+ * @param count set to the number of lines
+ * @return EXIT_SUCCESS or EXIT_FAILURE in case of allocation error
+ */
+int score_lines(const ChainScorer *scorer, const char *data, size_t size,
+                int threads, SequenceScore **scores, size_t *count);
+
+/**
+ * Free the tables of a scorer. The chain is left to the caller.
+ * @param scorer
+ */
+void free_scorer(ChainScorer *scorer);
+
+#endif //_MARKOV_SCORE_H_
@@ -0,0 +1,460 @@
+#include "markov_window.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_CAPACITY 16
+#define EMPTY_KEY 0
+
+/**
+ * Find the slot holding key, or the empty slot where it should go.
+ */
+static size_t find_edge_slot(const WindowChain *window_chain,
+                             const uint64_t key)
+{
+    const size_t mask = window_chain->edge_slots - 1;
+    size_t slot = transition_slot(key, window_chain->edge_slots);
+    while (window_chain->edge_keys[slot] != EMPTY_KEY &&
+           window_chain->edge_keys[slot] != key)
+    {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+static int alloc_edge_slots(WindowChain *window_chain, const size_t slots)
+{
+    uint64_t *keys = calloc(slots, sizeof(uint64_t));
+    int *positions = malloc(slots * sizeof(int));
+    if (keys == NULL || positions == NULL)
+    {
+        free(keys);
+        free(positions);
+        return EXIT_FAILURE;
+    }
+    window_chain->edge_keys = keys;
+    window_chain->edge_positions = positions;
+    window_chain->edge_slots = slots;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Double the number of slots and put every transition in its new slot.
+ */
+static int grow_edge_slots(WindowChain *window_chain)
+{
+    uint64_t *keys = window_chain->edge_keys;
+    int *positions = window_chain->edge_positions;
+    const size_t slots = window_chain->edge_slots;
+    if (alloc_edge_slots(window_chain, 2 * slots) == EXIT_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < slots; i++)
+    {
+        if (keys[i] != EMPTY_KEY)
+        {
+            const size_t slot = find_edge_slot(window_chain, keys[i]);
+            window_chain->edge_keys[slot] = keys[i];
+            window_chain->edge_positions[slot] = positions[i];
+        }
+    }
+    free(keys);
+    free(positions);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Empty a slot, shifting back the transitions probed past it so their
+ * lookups don't stop at it.
+ */
+static void remove_edge_slot(WindowChain *window_chain, size_t slot)
+{
+    const size_t mask = window_chain->edge_slots - 1;
+    uint64_t *keys = window_chain->edge_keys;
+    int *positions = window_chain->edge_positions;
+    keys[slot] = EMPTY_KEY;
+    for (size_t next = (slot + 1) & mask; keys[next] != EMPTY_KEY;
+         next = (next + 1) & mask)
+    {
+        const size_t home = transition_slot(keys[next],
+                                            window_chain->edge_slots);
+        if (((next - home) & mask) >= ((next - slot) & mask))
+        {
+            keys[slot] = keys[next];
+            positions[slot] = positions[next];
+            keys[next] = EMPTY_KEY;
+            slot = next;
+        }
+    }
+}
+
+/**
+ * Make room for state, so states[state] can be used.
+ */
+static int reserve_state(WindowChain *window_chain, const int state)
+{
+    if (state < window_chain->states_capacity)
+    {
+        return EXIT_SUCCESS;
+    }
+    int capacity = window_chain->states_capacity == 0
+                       ? MIN_CAPACITY
+                       : window_chain->states_capacity;
+    while (capacity <= state)
+    {
+        capacity *= 2;
+    }
+    WindowState *temp = realloc(window_chain->states,
+                                capacity * sizeof(WindowState));
+    if (temp == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+    memset(temp + window_chain->states_capacity, 0,
+           (capacity - window_chain->states_capacity) * sizeof(WindowState));
+    window_chain->states = temp;
+    window_chain->states_capacity = capacity;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Resize the transitions of a state. The sampling table is dropped, it is
+ * rebuilt with the new size on the next sample.
+ */
+static int resize_edges(WindowState *state, const int capacity)
+{
+    CsrEdge *temp = realloc(state->edges, capacity * sizeof(CsrEdge));
+    if (temp == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+    state->edges = temp;
+    state->edge_capacity = capacity;
+    free(state->cumulative);
+    state->cumulative = NULL;
+    state->cumulative_capacity = 0;
+    state->dirty = true;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Count one more appearance of the transition prev -> next.
+ */
+static int increment_edge(WindowChain *window_chain, const int prev,
+                          const int next)
+{
+    WindowState *state = &window_chain->states[prev];
+    const uint64_t key = transition_key(prev, next);
+    size_t slot = find_edge_slot(window_chain, key);
+    state->total++;
+    state->dirty = true;
+    if (window_chain->edge_keys[slot] == key)
+    {
+        state->edges[window_chain->edge_positions[slot]].frequency++;
+        return EXIT_SUCCESS;
+    }
+    if (state->edge_count == state->edge_capacity &&
+        resize_edges(state, state->edge_capacity == 0
+                                ? 1
+                                : 2 * state->edge_capacity) == EXIT_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+    state->edges[state->edge_count] = (CsrEdge){next, 1};
+    window_chain->edge_keys[slot] = key;
+    window_chain->edge_positions[slot] = state->edge_count++;
+    window_chain->edge_count++;
+    // keep the table at most half full
+    if (2 * window_chain->edge_count > window_chain->edge_slots)
+    {
+        return grow_edge_slots(window_chain);
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Forget one appearance of the transition prev -> next, removing it when
+ * no appearance is left.
+ */
+static int decrement_edge(WindowChain *window_chain, const int prev,
+                          const int next)
+{
+    WindowState *state = &window_chain->states[prev];
+    const size_t slot = find_edge_slot(window_chain,
+                                       transition_key(prev, next));
+    const int position = window_chain->edge_positions[slot];
+    state->total--;
+    state->dirty = true;
+    if (--state->edges[position].frequency > 0)
+    {
+        return EXIT_SUCCESS;
+    }
+    remove_edge_slot(window_chain, slot);
+    window_chain->edge_count--;
+    // move the last transition into the hole
+    const int last = --state->edge_count;
+    if (position != last)
+    {
+        state->edges[position] = state->edges[last];
+        const uint64_t moved = transition_key(prev,
+                                              state->edges[position].successor);
+        window_chain->edge_positions[find_edge_slot(window_chain, moved)] =
+            position;
+    }
+    if (state->edge_count > 0 && 4 * state->edge_count <= state->edge_capacity)
+    {
+        return resize_edges(state, state->edge_capacity / 2);
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Forget one event of a state, freeing the state and its word when it is
+ * not part of any live event anymore.
+ */
+static int release_state(WindowChain *window_chain, const int state)
+{
+    WindowState *window_state = &window_chain->states[state];
+    if (--window_state->references > 0)
+    {
+        return EXIT_SUCCESS;
+    }
+    // every transition of the state was one of its references
+    free(window_state->edges);
+    free(window_state->cumulative);
+    memset(window_state, 0, sizeof(WindowState));
+    return word_index_remove(&window_chain->index, state);
+}
+
+static int add_event(WindowBucket *bucket, const WindowEvent event)
+{
+    if (bucket->count == bucket->capacity)
+    {
+        const size_t capacity = bucket->capacity == 0
+                                    ? MIN_CAPACITY
+                                    : 2 * bucket->capacity;
+        WindowEvent *temp = realloc(bucket->events,
+                                    capacity * sizeof(WindowEvent));
+        if (temp == NULL)
+        {
+            return EXIT_FAILURE;
+        }
+        bucket->events = temp;
+        bucket->capacity = capacity;
+    }
+    bucket->events[bucket->count++] = event;
+    return EXIT_SUCCESS;
+}
+
+int init_window_chain(WindowChain *window_chain, const int bucket_count)
+{
+    memset(window_chain, 0, sizeof(WindowChain));
+    window_chain->bucket_count = bucket_count < 1 ? 1 : bucket_count;
+    window_chain->prev = NO_STATE;
+    window_chain->buckets = calloc(window_chain->bucket_count,
+                                   sizeof(WindowBucket));
+    if (window_chain->buckets == NULL ||
+        init_word_index(&window_chain->index, 0) == EXIT_FAILURE ||
+        alloc_edge_slots(window_chain, MIN_CAPACITY) == EXIT_FAILURE)
+    {
+        free_window_chain(window_chain);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int window_add_word(WindowChain *window_chain, const char *word,
+                    const size_t length, const bool is_last)
+{
+    const int next = word_index_add(&window_chain->index, word, length);
+    if (next == WORD_NOT_FOUND ||
+        reserve_state(window_chain, next) == EXIT_FAILURE)
+    {
+        return NO_STATE;
+    }
+    const int prev = window_chain->prev;
+    WindowBucket *bucket = &window_chain->buckets[window_chain->current];
+    if (add_event(bucket, (WindowEvent){prev, next}) == EXIT_FAILURE)
+    {
+        return NO_STATE;
+    }
+    WindowState *state = &window_chain->states[next];
+    if (state->references++ == 0)
+    {
+        state->is_last = is_last;
+    }
+    if (prev != NO_STATE)
+    {
+        window_chain->states[prev].references++;
+        if (increment_edge(window_chain, prev, next) == EXIT_FAILURE)
+        {
+            return NO_STATE;
+        }
+    }
+    // a word that ends a sentence has no transitions
+    window_chain->prev = is_last ? NO_STATE : next;
+    return next;
+}
+
+int advance_window(WindowChain *window_chain)
+{
+    window_chain->current =
+        (window_chain->current + 1) % window_chain->bucket_count;
+    WindowBucket *bucket = &window_chain->buckets[window_chain->current];
+    for (size_t i = 0; i < bucket->count; i++)
+    {
+        const WindowEvent event = bucket->events[i];
+        if (event.prev != NO_STATE &&
+            (decrement_edge(window_chain, event.prev,
+                            event.next) == EXIT_FAILURE ||
+             release_state(window_chain, event.prev) == EXIT_FAILURE))
+        {
+            return EXIT_FAILURE;
+        }
+        if (release_state(window_chain, event.next) == EXIT_FAILURE)
+        {
+            return EXIT_FAILURE;
+        }
+    }
+    bucket->count = 0;
+    // the sentence in progress may have been forgotten
+    if (window_chain->prev != NO_STATE &&
+        window_chain->states[window_chain->prev].references == 0)
+    {
+        window_chain->prev = NO_STATE;
+    }
+    return EXIT_SUCCESS;
+}
+
+static bool is_first_state(const WindowChain *window_chain, const int state)
+{
+    return window_chain->states[state].references > 0 &&
+           !window_chain->states[state].is_last;
+}
+
+int get_first_window_state(const WindowChain *window_chain)
+{
+    const int count = window_chain->index.count;
+    if (count == 0)
+    {
+        return NO_STATE;
+    }
+    // removed ids are reused, so most ids are live
+    for (int i = 0; i < count; i++)
+    {
+        const int state = rand() % count;
+        if (is_first_state(window_chain, state))
+        {
+            return state;
+        }
+    }
+    for (int state = 0; state < count; state++)
+    {
+        if (is_first_state(window_chain, state))
+        {
+            return state;
+        }
+    }
+    return NO_STATE;
+}
+
+/**
+ * Rebuild the sampling table of a state.
+ */
+static int refresh_state(WindowState *state)
+{
+    if (state->cumulative_capacity < state->edge_capacity)
+    {
+        long *temp = realloc(state->cumulative,
+                             state->edge_capacity * sizeof(long));
+        if (temp == NULL)
+        {
+            return EXIT_FAILURE;
+        }
+        state->cumulative = temp;
+        state->cumulative_capacity = state->edge_capacity;
+    }
+    long sum = 0;
+    for (int i = 0; i < state->edge_count; i++)
+    {
+        sum += state->edges[i].frequency;
+        state->cumulative[i] = sum;
+    }
+    state->dirty = false;
+    return EXIT_SUCCESS;
+}
+
+int get_next_window_state(WindowChain *window_chain, const int state)
+{
+    WindowState *window_state = &window_chain->states[state];
+    if (window_state->total == 0 ||
+        (window_state->dirty && refresh_state(window_state) == EXIT_FAILURE))
+    {
+        return NO_STATE;
+    }
+    const long index = rand() % window_state->total;
+    // first transition whose running sum is past index
+    int low = 0, high = window_state->edge_count - 1;
+    while (low < high)
+    {
+        const int middle = (low + high) / 2;
+        if (window_state->cumulative[middle] > index)
+        {
+            high = middle;
+        }
+        else
+        {
+            low = middle + 1;
+        }
+    }
+    return window_state->edges[low].successor;
+}
+
+size_t window_chain_memory(const WindowChain *window_chain)
+{
+    const WordIndex *index = &window_chain->index;
+    size_t bytes = sizeof(WindowChain) +
+                   index->capacity * sizeof(int) +
+                   index->words_capacity * sizeof(char*) +
+                   index->free_capacity * sizeof(int) +
+                   window_chain->states_capacity * sizeof(WindowState) +
+                   window_chain->edge_slots * (sizeof(uint64_t) + sizeof(int)) +
+                   window_chain->bucket_count * sizeof(WindowBucket);
+    for (int i = 0; i < index->count; i++)
+    {
+        if (index->words[i] != NULL)
+        {
+            const WindowState *state = &window_chain->states[i];
+            bytes += strlen(index->words[i]) + 1 +
+                     state->edge_capacity * sizeof(CsrEdge) +
+                     state->cumulative_capacity * sizeof(long);
+        }
+    }
+    for (int i = 0; i < window_chain->bucket_count; i++)
+    {
+        bytes += window_chain->buckets[i].capacity * sizeof(WindowEvent);
+    }
+    return bytes;
+}
+
+void free_window_chain(WindowChain *window_chain)
+{
+    for (int i = 0; i < window_chain->states_capacity; i++)
+    {
+        free(window_chain->states[i].edges);
+        free(window_chain->states[i].cumulative);
+    }
+    free(window_chain->states);
+    if (window_chain->buckets != NULL)
+    {
+        for (int i = 0; i < window_chain->bucket_count; i++)
+        {
+            free(window_chain->buckets[i].events);
+        }
+    }
+    free(window_chain->buckets);
+    free(window_chain->edge_keys);
+    free(window_chain->edge_positions);
+    free_word_index(&window_chain->index);
+    memset(window_chain, 0, sizeof(WindowChain));
+}
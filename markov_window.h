@@ -0,0 +1,124 @@
+#ifndef _MARKOV_WINDOW_H_
+#define _MARKOV_WINDOW_H_
+
+#include "markov_csr.h"
+#include "word_index.h"
+#include <stdint.h> // For uint64_t
+
+#define NO_STATE (-1)
+
+/**
+ * A word of a WindowChain, alive while it appears in a live bucket.
+ */
+typedef struct WindowState {
+    CsrEdge *edges;   // live transitions, in no particular order
+    int edge_count;
+    int edge_capacity;
+    long *cumulative; // sampling table: running sums of the frequencies
+    int cumulative_capacity;
+    long total;       // sum of the frequencies
+    int references;   // live events the word is part of
+    bool is_last;
+    bool dirty;       // cumulative is out of date
+} WindowState;
+
+/**
+ * An appearance of a word, after prev or NO_STATE at the start of a
+ * sentence.
+ */
+typedef struct WindowEvent {
+    int prev;
+    int next;
+} WindowEvent;
+
+/**
+ * Events of a period of time, in the order they happened.
+ */
+typedef struct WindowBucket {
+    WindowEvent *events;
+    size_t count;
+    size_t capacity;
+} WindowBucket;
+
+/**
+ * Chain of words trained on the last bucket_count periods of a stream.
+ * When a new period starts the events of the oldest one are subtracted,
+ * and the words and transitions they leave without appearances are freed,
+ * so memory depends on the window and not on the length of the stream.
+ * Sampling tables are rebuilt on demand, only for states that changed.
+ */
+typedef struct WindowChain {
+    WordIndex index;        // word of every state, state i is index.words[i]
+    WindowState *states;    // index.count entries in use
+    int states_capacity;
+    uint64_t *edge_keys;    // hash table of the live transitions
+    int *edge_positions;    // position of every transition in its edges
+    size_t edge_slots;      // number of slots, a power of two
+    size_t edge_count;
+    WindowBucket *buckets;  // ring of bucket_count buckets
+    int bucket_count;
+    int current;            // bucket receiving new events
+    int prev;               // last word added, or NO_STATE
+} WindowChain;
+
+/**
+ * Initialize an empty chain.
+ * @param window_chain chain to initialize
+ * @param bucket_count number of periods the chain remembers, at least 1
+ * @return EXIT_SUCCESS or EXIT_FAILURE in case of allocation error
+ */
+int init_window_chain(WindowChain *window_chain, int bucket_count);
+
+/**
+ * Add the next word of the stream to the current period. A word ending a
+ * sentence has no transition to the word after it, like in fill_database().
+ * @param window_chain
+ * @param word start of the word
+ * @param length length of the word
+ * @param is_last whether the word ends a sentence
+ * @return state of the word, or NO_STATE in case of allocation error, in
+ * which case the chain should be freed
+ */
+int window_add_word(WindowChain *window_chain, const char *word,
+                    size_t length, bool is_last);
+
+/**
+ * Start a new period, forgetting the events of the oldest one.
+ * @param window_chain
+ * @return EXIT_SUCCESS or EXIT_FAILURE in case of allocation error, in
+ * which case the chain should be freed
+ */
+int advance_window(WindowChain *window_chain);
+
+/**
+ * Choose randomly a live state that doesn't end a sentence.
+ * @param window_chain
+ * @return the chosen state, or NO_STATE if there is none
+ */
+int get_first_window_state(const WindowChain *window_chain);
+
+/**
+ * Choose randomly the next state, depend on it's frequency in the window.
+ * Rebuilds the sampling table of state if it changed since it was last
+ * used.
+ * @param window_chain
+ * @param state live state to choose from
+ * @return the chosen state, or NO_STATE if state has no transitions or in
+ * case of allocation error
+ */
+int get_next_window_state(WindowChain *window_chain, int state);
+
+/**
+ * Count the bytes allocated by the chain, including the words.
+ * @param window_chain
+ * @return number of bytes
+ */
+size_t window_chain_memory(const WindowChain *window_chain);
+
+/**
+ * Free window_chain and all of it's content from memory
+ * @param window_chain chain to free
+ */
+void free_window_chain(WindowChain *window_chain);
+
+#endif //_MARKOV_WINDOW_H_
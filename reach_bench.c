@@ -0,0 +1,170 @@
+#include "markov_chain.h"
+#include "markov_csr.h"
+#include "markov_reach.h"
+#include "tweets_database.h"
+#include "bench_utils.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+#define NUM_ARGS_ERROR "Usage: reach_bench <file_path> [sequences] [max_length]"
+#define DEFAULT_SEQUENCES 1000000
+#define DEFAULT_MAX_LENGTH 20 // MAX_WORDS_IN_TWEET
+#define SEED 1234
+#define REPEATS 5 // runs of every generator, the fastest is reported
+#define DECIMAL 10
+#define MIN_ARGS 2
+#define FILE_ARG 1
+#define SEQUENCES_ARG 2
+#define MAX_LENGTH_ARG 3
+#define MAX_ARGS 4
+
+/**
+ * Generate sequences like get_first_random_node() and
+ * generate_random_sequence(), keeping only the ones that end at a last
+ * state, until sequences of them are found.
+ * @param report whether to print how many were rejected
+ * @return the seconds it took
+ */
+static double generate_and_reject(const CsrMarkovChain *csr_chain,
+                                  const long sequences, const int max_length,
+                                  const bool report)
+{
+    long attempts = 0, dead_ends = 0, too_long = 0, states = 0;
+    const double start = now_seconds();
+    for (long found = 0; found < sequences; attempts++)
+    {
+        int state;
+        do
+        {
+            state = rand() % csr_chain->size;
+        } while (csr_chain->is_last[state]);
+        int length = 1;
+        while (!csr_chain->is_last[state] && length < max_length)
+        {
+            state = get_next_random_state(csr_chain, state);
+            if (state == -1)
+            {
+                break;
+            }
+            length++;
+        }
+        if (state == -1)
+        {
+            dead_ends++;
+        }
+        else if (!csr_chain->is_last[state])
+        {
+            too_long++;
+        }
+        else
+        {
+            found++;
+            states += length;
+        }
+    }
+    const double seconds = now_seconds() - start;
+    if (report)
+    {
+        printf("reject       %.2f attempts each  (%ld dead ends, %ld too long)"
+               "  mean length %.3f\n", (double)attempts / sequences, dead_ends,
+               too_long, (double)states / sequences);
+    }
+    return seconds;
+}
+
+/**
+ * Generate sequences that end at a last state with a ReachTable, and time
+ * it against generate_and_reject().
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int compare_generators(const CsrMarkovChain *csr_chain,
+                              const long sequences, const int max_length)
+{
+    ReachTable reach_table;
+    int *sequence = malloc(max_length * sizeof(int));
+    double start = now_seconds();
+    if (sequence == NULL ||
+        build_reach_table(&reach_table, csr_chain, max_length) == EXIT_FAILURE)
+    {
+        free(sequence);
+        printf(ALLOCATION_ERROR_MASSAGE);
+        return EXIT_FAILURE;
+    }
+    const double build_seconds = now_seconds() - start;
+    int can_finish = 0;
+    for (int i = 0; i < csr_chain->size; i++)
+    {
+        can_finish += reach_table.can_finish[i];
+    }
+    printf("states %d  can finish %d  can finish within %d: %d first states"
+           "  (analysis %.3f sec)\n", csr_chain->size, can_finish, max_length,
+           reach_table.first_count, build_seconds);
+    // without first states no sequence ends, and rejecting never stops
+    if (reach_table.first_count == 0)
+    {
+        free(sequence);
+        free_reach_table(&reach_table);
+        return EXIT_SUCCESS;
+    }
+    // the generators take turns, so a slow spell of the machine hits both
+    double best_conditioned = 0, best_reject = 0;
+    for (int repeat = 0; repeat < REPEATS; repeat++)
+    {
+        long states = 0;
+        start = now_seconds();
+        for (long i = 0; i < sequences; i++)
+        {
+            states += generate_finishing_sequence(&reach_table, sequence);
+        }
+        const double seconds = now_seconds() - start;
+        if (repeat == 0)
+        {
+            printf("conditioned  1.00 attempts each  mean length %.3f\n",
+                   (double)states / sequences);
+        }
+        const double reject_seconds = generate_and_reject(
+            csr_chain, sequences, max_length, repeat == 0);
+        if (repeat == 0 || seconds < best_conditioned)
+        {
+            best_conditioned = seconds;
+        }
+        if (repeat == 0 || reject_seconds < best_reject)
+        {
+            best_reject = reject_seconds;
+        }
+    }
+    printf("complete/sec, best of %d:  conditioned %.0f  reject %.0f\n",
+           REPEATS, sequences / best_conditioned, sequences / best_reject);
+    free(sequence);
+    free_reach_table(&reach_table);
+    return EXIT_SUCCESS;
+}
+
+int main(const int argc, char *argv[])
+{
+    if (argc < MIN_ARGS || argc > MAX_ARGS)
+    {
+        printf(NUM_ARGS_ERROR);
+        return EXIT_FAILURE;
+    }
+    const long sequences = argc > SEQUENCES_ARG
+                               ? strtol(argv[SEQUENCES_ARG], NULL, DECIMAL)
+                               : DEFAULT_SEQUENCES;
+    const int max_length = argc > MAX_LENGTH_ARG
+                               ? strtol(argv[MAX_LENGTH_ARG], NULL, DECIMAL)
+                               : DEFAULT_MAX_LENGTH;
+    if (sequences < 1 || max_length < 2)
+    {
+        printf(NUM_ARGS_ERROR);
+        return EXIT_FAILURE;
+    }
+    CsrMarkovChain csr_chain;
+    if (train_csr_chain(argv[FILE_ARG], &csr_chain) == EXIT_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+    srand(SEED);
+    const int res = compare_generators(&csr_chain, sequences, max_length);
+    free_csr_chain(&csr_chain);
+    return res;
+}
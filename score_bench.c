@@ -0,0 +1,161 @@
+#include "markov_chain.h"
+#include "markov_csr.h"
+#include "markov_score.h"
+#include "tweets_database.h"
+#include "bench_utils.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#define NUM_ARGS_ERROR "Usage: score_bench <model_file> <score_file> [threads] [alpha]"
+#define MIN_INPUT_SIZE (32 * 1024 * 1024)
+#define DEFAULT_ALPHA 0.1
+#define REPEATS 3
+#define DECIMAL 10
+#define MIN_ARGS 3
+#define THREADS_ARG 3
+#define ALPHA_ARG 4
+#define MAX_ARGS 5
+
+/**
+ * Read a file and repeat it until it holds at least MIN_INPUT_SIZE bytes,
+ * so the timings are long enough to measure.
+ * @return newly allocated text, or NULL on failure
+ */
+static char *load_input(const char *file_path, size_t *size)
+{
+    FILE *file = fopen(file_path, "r");
+    if (file == NULL)
+    {
+        printf(FILE_PATH_ERROR);
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    const long file_size = ftell(file);
+    rewind(file);
+    if (file_size <= 0)
+    {
+        fclose(file);
+        return NULL;
+    }
+    // one extra byte per copy for a line break between copies
+    const size_t copies = (MIN_INPUT_SIZE + file_size - 1) / file_size;
+    char *data = malloc(copies * (file_size + 1));
+    if (data == NULL)
+    {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        fclose(file);
+        return NULL;
+    }
+    size_t read = fread(data, 1, file_size, file);
+    fclose(file);
+    if (read > 0 && data[read - 1] != '\n')
+    {
+        data[read++] = '\n';
+    }
+    for (size_t i = 1; i < copies; i++)
+    {
+        memcpy(data + i * read, data, read);
+    }
+    *size = copies * read;
+    return data;
+}
+
+static void report(const ChainScorer *scorer, const char *data,
+                   const size_t size, const int threads)
+{
+    double best = 0;
+    for (int i = 0; i < REPEATS; i++)
+    {
+        SequenceScore *scores = NULL;
+        size_t lines = 0;
+        const double start = now_seconds();
+        if (score_lines(scorer, data, size, threads, &scores,
+                        &lines) == EXIT_FAILURE)
+        {
+            return;
+        }
+        const double seconds = now_seconds() - start;
+        if (i == 0 || seconds < best)
+        {
+            best = seconds;
+        }
+        long tokens = 0, transitions = 0;
+        double log_likelihood = 0;
+        for (size_t j = 0; j < lines; j++)
+        {
+            tokens += scores[j].tokens;
+            transitions += scores[j].transitions;
+            log_likelihood += scores[j].log_likelihood;
+        }
+        free(scores);
+        if (i == REPEATS - 1)
+        {
+            printf("threads %2d  %12.0f tokens/sec  %10zu lines  %10ld tokens"
+                   "  perplexity %.3f\n", threads, tokens / best, lines,
+                   tokens, exp(-log_likelihood / transitions));
+        }
+    }
+}
+
+int main(const int argc, char *argv[])
+{
+    if (argc < MIN_ARGS || argc > MAX_ARGS)
+    {
+        printf(NUM_ARGS_ERROR);
+        return EXIT_FAILURE;
+    }
+    long max_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (argc > THREADS_ARG)
+    {
+        max_threads = strtol(argv[THREADS_ARG], NULL, DECIMAL);
+    }
+    if (max_threads < 1)
+    {
+        max_threads = 1;
+    }
+    const double alpha = argc > ALPHA_ARG
+                             ? strtod(argv[ALPHA_ARG], NULL)
+                             : DEFAULT_ALPHA;
+    CsrMarkovChain csr_chain;
+    if (train_csr_chain(argv[1], &csr_chain) == EXIT_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+    ChainScorer scorer;
+    if (init_scorer(&scorer, &csr_chain, alpha) == EXIT_FAILURE)
+    {
+        free_csr_chain(&csr_chain);
+        return EXIT_FAILURE;
+    }
+    size_t size = 0;
+    char *data = load_input(argv[2], &size);
+    if (data == NULL)
+    {
+        free_scorer(&scorer);
+        free_csr_chain(&csr_chain);
+        return EXIT_FAILURE;
+    }
+    printf("states %d  transitions %d  alpha %g  input %zu bytes  "
+           "tokenizer %s\n", csr_chain.size, csr_chain.offsets[csr_chain.size],
+           alpha, size, tokenizer_isa_name(tokenizer_active_isa()));
+    // powers of two up to max_threads, then max_threads itself
+    for (long threads = 1;; threads *= 2)
+    {
+        if (threads > max_threads)
+        {
+            threads = max_threads;
+        }
+        report(&scorer, data, size, threads);
+        if (threads >= max_threads)
+        {
+            break;
+        }
+    }
+    free(data);
+    free_scorer(&scorer);
+    free_csr_chain(&csr_chain);
+    return EXIT_SUCCESS;
+}
@@ -2,7 +2,8 @@
 #include "markov_chain.h"
 
 #define MAX(X, Y) (((X) < (Y)) ? (Y) : (X))
-#define ARGS_NUM 3
+#define ARGS_WITHOUT_OPTIONAL 3
+#define ARGS_WITH_OPTIONAL 4
 #define EMPTY -1
 #define BOARD_SIZE 100
 #define MAX_GENERATION_LENGTH 60
@@ -10,6 +11,8 @@
 #define DICE_MAX 6
 #define NUM_OF_TRANSITIONS 20
 #define NUM_ARGS_ERROR "Usage: invalid number of arguments"
+#define FILE_PATH_ERROR "Error: incorrect file path"
+#define BOARD_FILE_ERROR "Error: invalid board file"
 
 /**
  * represents the transitions by ladders and snakes in the game
@@ -51,6 +54,20 @@ typedef struct Cell
     //both ladder_to and snake_to should be -1 if the Cell doesn't have them
 } Cell;
 
+/**
+ * struct represents a whole game board: its cells and the dice used
+ */
+typedef struct Board
+{
+    Cell* cells; // cells[i] is the Cell number i + 1
+    int size;
+    int dice_max;
+} Board;
+
+// number of the last cell of the board in play, read by is_last_cell()
+// and print_cell()
+static int board_size = BOARD_SIZE;
+
 /** Error handler **/
 int handle_error_snakes(char* error_msg, MarkovChain** database)
 {
@@ -63,93 +80,161 @@ int handle_error_snakes(char* error_msg, MarkovChain** database)
 }
 
 
-int create_board(Cell* cells[BOARD_SIZE])
+/**
+ * Allocate the cells of a board without snakes or ladders.
+ * @param board board to fill
+ * @param size number of cells
+ * @param dice_max number of sides of the dice
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int init_board(Board* board, const int size, const int dice_max)
 {
-    for (int i = 0; i < BOARD_SIZE; i++)
+    board->cells = malloc(size * sizeof(Cell));
+    if (board->cells == NULL)
     {
-        cells[i] = malloc(sizeof(Cell));
-        if (cells[i] == NULL)
-        {
-            for (int j = 0; j < i; j++)
-            {
-                free(cells[j]);
-            }
-            handle_error_snakes(ALLOCATION_ERROR_MASSAGE,NULL);
-            return EXIT_FAILURE;
-        }
-        *(cells[i]) = (Cell){i + 1, EMPTY, EMPTY};
+        return handle_error_snakes(ALLOCATION_ERROR_MASSAGE, NULL);
+    }
+    for (int i = 0; i < size; i++)
+    {
+        board->cells[i] = (Cell){i + 1, EMPTY, EMPTY};
+    }
+    board->size = size;
+    board->dice_max = dice_max;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Put a ladder from cell from to cell to if from < to, or a snake otherwise.
+ * @return EXIT_SUCCESS or EXIT_FAILURE if the transition is not valid
+ */
+static int add_board_transition(Board* board, const int from, const int to)
+{
+    if (from < 1 || from >= board->size || to < 1 || to > board->size ||
+        from == to)
+    {
+        return EXIT_FAILURE;
+    }
+    Cell* cell = &board->cells[from - 1];
+    if (cell->ladder_to != EMPTY || cell->snake_to != EMPTY)
+    {
+        return EXIT_FAILURE;
+    }
+    if (from < to)
+    {
+        cell->ladder_to = to;
+    }
+    else
+    {
+        cell->snake_to = to;
     }
+    return EXIT_SUCCESS;
+}
 
+/**
+ * Create the default 100 cells board from the transitions table.
+ * @param board board to fill
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int create_board(Board* board)
+{
+    if (init_board(board, BOARD_SIZE, DICE_MAX) == EXIT_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
     for (int i = 0; i < NUM_OF_TRANSITIONS; i++)
     {
-        int from = transitions[i][0];
-        int to = transitions[i][1];
-        if (from < to)
-        {
-            cells[from - 1]->ladder_to = to;
-        }
-        else
-        {
-            cells[from - 1]->snake_to = to;
-        }
+        add_board_transition(board, transitions[i][0], transitions[i][1]);
     }
     return EXIT_SUCCESS;
 }
 
 /**
- * fills database
- * @param markov_chain
+ * Load a board from a text file. The file holds the number of cells and
+ * the number of sides of the dice, followed by a "from to" pair for every
+ * snake and ladder, for example:
+ *     100 6
+ *     13 4
+ *     8 30
+ * @param file_path path of the board file
+ * @param board board to fill
  * @return EXIT_SUCCESS or EXIT_FAILURE
  */
-int fill_database_snakes(MarkovChain* markov_chain)
+int load_board(const char* file_path, Board* board)
 {
-    Cell* cells[BOARD_SIZE];
-    if (create_board(cells) == EXIT_FAILURE)
+    FILE* file = fopen(file_path, "r");
+    if (file == NULL)
+    {
+        return handle_error_snakes(FILE_PATH_ERROR, NULL);
+    }
+    int size, dice_max;
+    if (fscanf(file, "%d %d", &size, &dice_max) != 2 || size < 2 ||
+        dice_max < 1)
     {
+        fclose(file);
+        return handle_error_snakes(BOARD_FILE_ERROR, NULL);
+    }
+    if (init_board(board, size, dice_max) == EXIT_FAILURE)
+    {
+        fclose(file);
         return EXIT_FAILURE;
     }
-    MarkovNode *from_node = NULL, *to_node = NULL;
-    size_t index_to;
-    for (size_t i = 0; i < BOARD_SIZE; i++)
+    int from, to, read;
+    while ((read = fscanf(file, "%d %d", &from, &to)) == 2)
     {
-        add_to_database(markov_chain, cells[i]);
+        if (add_board_transition(board, from, to) == EXIT_FAILURE)
+        {
+            break;
+        }
     }
-    for (size_t i = 0; i < BOARD_SIZE; i++)
+    fclose(file);
+    if (read != EOF)
     {
-        from_node = get_node_from_database(markov_chain, cells[i])->data;
+        free(board->cells);
+        board->cells = NULL;
+        return handle_error_snakes(BOARD_FILE_ERROR, NULL);
+    }
+    return EXIT_SUCCESS;
+}
 
-        if (cells[i]->snake_to != EMPTY || cells[i]->ladder_to != EMPTY)
+/**
+ * fills a dense chain whose state i is the Cell number i + 1. Every cell
+ * reaches its targets by index, so building is linear in the board size.
+ * @param dense_chain
+ * @param board
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int fill_database_snakes(DenseMarkovChain* dense_chain, Board* board)
+{
+    if (init_dense_chain(dense_chain, board->cells, sizeof(Cell),
+                         board->size) == EXIT_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < board->size; i++)
+    {
+        const Cell* cell = &board->cells[i];
+        if (cell->snake_to != EMPTY || cell->ladder_to != EMPTY)
         {
-            index_to = MAX(cells[i]->snake_to, cells[i]->ladder_to) - 1;
-            to_node = get_node_from_database(markov_chain,
-                                             cells[index_to])->data;
-            add_node_to_frequency_list(from_node,
-                                       to_node, markov_chain);
+            const int index_to = MAX(cell->snake_to, cell->ladder_to) - 1;
+            if (add_dense_transition(dense_chain, i, index_to) == EXIT_FAILURE)
+            {
+                return EXIT_FAILURE;
+            }
+            continue;
         }
-        else
+        for (int j = 1; j <= board->dice_max; j++)
         {
-            for (int j = 1; j <= DICE_MAX; j++)
+            const int index_to = i + j;
+            if (index_to >= board->size)
+            {
+                break;
+            }
+            if (add_dense_transition(dense_chain, i, index_to) == EXIT_FAILURE)
             {
-                index_to = ((Cell*)(from_node->data))->number + j - 1;
-                if (index_to >= BOARD_SIZE)
-                {
-                    break;
-                }
-                to_node = get_node_from_database(markov_chain,
-                                                 cells[index_to])->data;
-                int res = add_node_to_frequency_list(from_node,
-                                                     to_node, markov_chain);
-                if (res == EXIT_FAILURE)
-                {
-                    return EXIT_FAILURE;
-                }
+                return EXIT_FAILURE;
             }
         }
     }
-    for (size_t i = 0; i < BOARD_SIZE; i++)
-    {
-        free(cells[i]);
-    }
     return EXIT_SUCCESS;
 }
 
@@ -166,7 +251,7 @@ void print_cell(void* cell)
     {
         printf("-snake to");
     }
-    if (cell_num != BOARD_SIZE)
+    if (cell_num != board_size)
     {
         printf("->");
     }
@@ -200,7 +285,7 @@ void* copy_cell(void* cell)
 bool is_last_cell(void* cell)
 {
     const Cell* cell_ptr = cell;
-    if (cell_ptr->number == BOARD_SIZE)
+    if (cell_ptr->number == board_size)
     {
         return true;
     }
@@ -212,11 +297,12 @@ bool is_last_cell(void* cell)
  * @param argc num of arguments
  * @param argv 1) Seed
  *             2) Number of sentences to generate
+ *             3) Optional path of a board file, see load_board()
  * @return EXIT_SUCCESS or EXIT_FAILURE
  */
 int main(int argc, char* argv[])
 {
-    if (argc != ARGS_NUM)
+    if (argc != ARGS_WITHOUT_OPTIONAL && argc != ARGS_WITH_OPTIONAL)
     {
         printf(NUM_ARGS_ERROR);
         return EXIT_FAILURE;
@@ -224,28 +310,35 @@ int main(int argc, char* argv[])
     const unsigned int seed = strtol(argv[1], NULL, DECIMAL);
     srand(seed);
     const unsigned int path_num = strtol(argv[2], NULL, DECIMAL);
-    LinkedList link_list = {NULL, NULL, 0};
-    MarkovChain markov_chain = {
-        &link_list, print_cell, comp_cells,
-        free_cell, copy_cell, is_last_cell
-    };
-    MarkovChain* markov_chain_ptr = &markov_chain;
-    Cell* cells[BOARD_SIZE];
-    if (create_board(cells) == EXIT_FAILURE)
+    Board board;
+    const int res = argc == ARGS_WITH_OPTIONAL
+                        ? load_board(argv[3], &board)
+                        : create_board(&board);
+    if (res == EXIT_FAILURE)
     {
         return EXIT_FAILURE;
     }
-    if (fill_database_snakes(markov_chain_ptr) == EXIT_FAILURE)
+    board_size = board.size;
+    // the dense chain replaces the database, only the callbacks are used
+    MarkovChain markov_chain = {
+        NULL, print_cell, comp_cells,
+        free_cell, copy_cell, is_last_cell
+    };
+    DenseMarkovChain dense_chain = {NULL, 0};
+    if (fill_database_snakes(&dense_chain, &board) == EXIT_FAILURE)
     {
+        free_dense_chain(&dense_chain);
+        free(board.cells);
         return EXIT_FAILURE;
     }
-    MarkovNode* first_node = link_list.first->data;
+    MarkovNode* first_node = &dense_chain.nodes[0];
     for (unsigned int i = 1; i <= path_num; i++)
     {
         printf("Random Walk %d: ", i);
-        generate_random_sequence(markov_chain_ptr,
+        generate_random_sequence(&markov_chain,
                                  first_node, MAX_GENERATION_LENGTH);
     }
-    free_markov_chain(&markov_chain_ptr);
+    free_dense_chain(&dense_chain);
+    free(board.cells);
     return EXIT_SUCCESS;
 }
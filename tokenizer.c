@@ -0,0 +1,388 @@
+#include "tokenizer.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAS_X86_SIMD
+#endif
+
+#define BLOCK_SIZE 64
+#define SSE2_WIDTH 16
+#define AVX2_WIDTH 32
+
+/**
+ * Classify BLOCK_SIZE bytes.
+ * @param newlines set to the mask of the newlines among them
+ * @return mask with bit i set if block[i] is a delimiter
+ */
+typedef uint64_t (*classify_func)(const char *block, uint64_t *newlines);
+
+static bool is_delimiter(const char c)
+{
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+static uint64_t classify_scalar(const char *block, uint64_t *newlines)
+{
+    uint64_t mask = 0;
+    *newlines = 0;
+    for (int i = 0; i < BLOCK_SIZE; i++)
+    {
+        mask |= (uint64_t)is_delimiter(block[i]) << i;
+        *newlines |= (uint64_t)(block[i] == '\n') << i;
+    }
+    return mask;
+}
+
+#ifdef HAS_X86_SIMD
+
+__attribute__((target("sse2")))
+static uint64_t classify_sse2(const char *block, uint64_t *newlines)
+{
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i carriage = _mm_set1_epi8('\r');
+    uint64_t mask = 0;
+    *newlines = 0;
+    for (int i = 0; i < BLOCK_SIZE; i += SSE2_WIDTH)
+    {
+        const __m128i chunk = _mm_loadu_si128((const __m128i*)(block + i));
+        const __m128i newline_hits = _mm_cmpeq_epi8(chunk, newline);
+        const __m128i hits = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, space), newline_hits),
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, tab),
+                         _mm_cmpeq_epi8(chunk, carriage)));
+        mask |= (uint64_t)(unsigned int)_mm_movemask_epi8(hits) << i;
+        *newlines |=
+            (uint64_t)(unsigned int)_mm_movemask_epi8(newline_hits) << i;
+    }
+    return mask;
+}
+
+__attribute__((target("avx2")))
+static uint64_t classify_avx2(const char *block, uint64_t *newlines)
+{
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i carriage = _mm256_set1_epi8('\r');
+    uint64_t mask = 0;
+    *newlines = 0;
+    for (int i = 0; i < BLOCK_SIZE; i += AVX2_WIDTH)
+    {
+        const __m256i chunk = _mm256_loadu_si256((const __m256i*)(block + i));
+        const __m256i newline_hits = _mm256_cmpeq_epi8(chunk, newline);
+        const __m256i hits = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, space), newline_hits),
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, tab),
+                            _mm256_cmpeq_epi8(chunk, carriage)));
+        mask |= (uint64_t)(unsigned int)_mm256_movemask_epi8(hits) << i;
+        *newlines |=
+            (uint64_t)(unsigned int)_mm256_movemask_epi8(newline_hits) << i;
+    }
+    return mask;
+}
+
+#endif
+
+static classify_func active_classify = NULL;
+static TokenizerIsa active_isa = TOKENIZER_ISA_AUTO;
+
+TokenizerIsa tokenizer_select_isa(TokenizerIsa isa)
+{
+#ifdef HAS_X86_SIMD
+    __builtin_cpu_init();
+    const bool has_sse2 = __builtin_cpu_supports("sse2");
+    const bool has_avx2 = __builtin_cpu_supports("avx2");
+    if (isa == TOKENIZER_ISA_AUTO)
+    {
+        isa = TOKENIZER_ISA_AVX2;
+    }
+    if (isa == TOKENIZER_ISA_AVX2 && !has_avx2)
+    {
+        isa = TOKENIZER_ISA_SSE2;
+    }
+    if (isa == TOKENIZER_ISA_SSE2 && !has_sse2)
+    {
+        isa = TOKENIZER_ISA_SCALAR;
+    }
+#else
+    isa = TOKENIZER_ISA_SCALAR;
+#endif
+    switch (isa)
+    {
+#ifdef HAS_X86_SIMD
+    case TOKENIZER_ISA_AVX2:
+        active_classify = classify_avx2;
+        break;
+    case TOKENIZER_ISA_SSE2:
+        active_classify = classify_sse2;
+        break;
+#endif
+    default:
+        isa = TOKENIZER_ISA_SCALAR;
+        active_classify = classify_scalar;
+        break;
+    }
+    active_isa = isa;
+    return isa;
+}
+
+const char *tokenizer_isa_name(const TokenizerIsa isa)
+{
+    switch (isa)
+    {
+    case TOKENIZER_ISA_AVX2:
+        return "avx2";
+    case TOKENIZER_ISA_SSE2:
+        return "sse2";
+    case TOKENIZER_ISA_SCALAR:
+        return "scalar";
+    default:
+        return "auto";
+    }
+}
+
+static classify_func get_classify(void)
+{
+    if (active_classify == NULL)
+    {
+        tokenizer_select_isa(TOKENIZER_ISA_AUTO);
+    }
+    return active_classify;
+}
+
+TokenizerIsa tokenizer_active_isa(void)
+{
+    get_classify();
+    return active_isa;
+}
+
+size_t scan_tokens(const char **cursor, const char *end, TokenSpan *spans,
+                   const size_t max_spans)
+{
+    const classify_func classify = get_classify();
+    const char *p = *cursor;
+    uint64_t prev_delimiter = 1;
+    bool line_carry = false; // a newline is in the delimiters ending a block
+    size_t opened = 0; // words whose start was found
+    size_t closed = 0; // words whose stop was found too
+    // keep room for a whole block, but never stop before a word is closed
+    while (p < end && (opened + SCAN_MIN_SPANS <= max_spans || closed == 0))
+    {
+        uint64_t delimiters, newlines;
+        if (end - p >= BLOCK_SIZE)
+        {
+            delimiters = classify(p, &newlines);
+        }
+        else
+        {
+            // pad the tail with delimiters, so a word that touches end
+            // is closed inside this block
+            char tail[BLOCK_SIZE];
+            memset(tail, ' ', BLOCK_SIZE);
+            memcpy(tail, p, end - p);
+            delimiters = classify(tail, &newlines);
+        }
+        // a word starts at a non delimiter that follows a delimiter and
+        // stops at a delimiter that follows a non delimiter. starts and
+        // stops alternate, so the k-th stop belongs to the k-th start
+        const uint64_t shifted = delimiters << 1 | prev_delimiter;
+        uint64_t starts = ~delimiters & shifted;
+        uint64_t stops = delimiters & ~shifted;
+        // adding its newlines to a run of delimiters carries out of the run
+        // into the start of the word after it, or into the next block
+        uint64_t line_starts;
+        const bool carry = __builtin_add_overflow(delimiters, newlines,
+                                                  &line_starts);
+        line_carry = __builtin_add_overflow(line_starts, (uint64_t)line_carry,
+                                            &line_starts) || carry;
+        while (starts != 0)
+        {
+            const int offset = __builtin_ctzll(starts);
+            spans[opened].start = p + offset;
+            spans[opened++].starts_line = line_starts >> offset & 1;
+            starts &= starts - 1;
+        }
+        while (stops != 0)
+        {
+            const char *stop = p + __builtin_ctzll(stops);
+            stops &= stops - 1;
+            TokenSpan *span = &spans[closed++];
+            span->length = stop - span->start;
+            span->is_last = stop[-1] == SENTENCE_END;
+        }
+        prev_delimiter = delimiters >> (BLOCK_SIZE - 1);
+        p += BLOCK_SIZE;
+    }
+    if (p >= end)
+    {
+        if (opened > closed)
+        {
+            // the last full block ended inside a word
+            TokenSpan *span = &spans[closed++];
+            span->length = end - span->start;
+            span->is_last = end[-1] == SENTENCE_END;
+        }
+        *cursor = end;
+        return closed;
+    }
+    // out of room: forget the open word and continue after the delimiter
+    // that stopped the last closed one
+    if (closed > 0)
+    {
+        *cursor = spans[closed - 1].start + spans[closed - 1].length + 1;
+    }
+    return closed;
+}
+
+int tokenizer_init(Tokenizer *tokenizer, FILE *fp, const size_t capacity)
+{
+    char *buffer = malloc(capacity + 1);
+    if (buffer == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+    tokenizer->fp = fp;
+    tokenizer->buffer = buffer;
+    tokenizer->capacity = capacity;
+    tokenizer->position = tokenizer->length = 0;
+    tokenizer->eof = false;
+    tokenizer->line_pending = true;
+    tokenizer->span_count = tokenizer->span_index = 0;
+    get_classify();
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Append as many bytes as fit in the buffer from the file.
+ */
+static void refill(Tokenizer *tokenizer)
+{
+    const size_t requested = tokenizer->capacity - tokenizer->length;
+    const size_t received = fread(tokenizer->buffer + tokenizer->length, 1,
+                                  requested, tokenizer->fp);
+    tokenizer->length += received;
+    if (received < requested)
+    {
+        tokenizer->eof = true;
+    }
+}
+
+/**
+ * Move the unfinished word at position to the front of the buffer, growing
+ * the buffer if the word fills all of it, and read the rest of the file
+ * after it.
+ * @return EXIT_SUCCESS or EXIT_FAILURE in case of allocation error
+ */
+static int move_partial_word(Tokenizer *tokenizer)
+{
+    const size_t partial = tokenizer->length - tokenizer->position;
+    if (partial == tokenizer->capacity)
+    {
+        char *temp = realloc(tokenizer->buffer, 2 * tokenizer->capacity + 1);
+        if (temp == NULL)
+        {
+            return EXIT_FAILURE;
+        }
+        tokenizer->buffer = temp;
+        tokenizer->capacity *= 2;
+    }
+    memmove(tokenizer->buffer, tokenizer->buffer + tokenizer->position,
+            partial);
+    tokenizer->position = 0;
+    tokenizer->length = partial;
+    refill(tokenizer);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @return whether [from, stop) holds a newline
+ */
+static bool has_newline(const char *from, const char *stop)
+{
+    return memchr(from, '\n', stop - from) != NULL;
+}
+
+int tokenizer_next(Tokenizer *tokenizer, TokenSpan *span)
+{
+    while (1)
+    {
+        if (tokenizer->span_index < tokenizer->span_count)
+        {
+            *span = tokenizer->spans[tokenizer->span_index++];
+            return TOKEN_FOUND;
+        }
+        const char *scan_start = tokenizer->buffer + tokenizer->position;
+        const char *cursor = scan_start;
+        const char *end = tokenizer->buffer + tokenizer->length;
+        size_t count = scan_tokens(&cursor, end, tokenizer->spans,
+                                   TOKENIZER_BATCH);
+        if (count == 0)
+        {
+            if (has_newline(scan_start, end))
+            {
+                tokenizer->line_pending = true;
+            }
+            if (tokenizer->eof)
+            {
+                tokenizer->position = tokenizer->length;
+                return TOKEN_END;
+            }
+            tokenizer->position = tokenizer->length = 0;
+            refill(tokenizer);
+            continue;
+        }
+        const TokenSpan *last = &tokenizer->spans[count - 1];
+        // the word may continue in the file, leave it for later
+        const bool partial = last->start + last->length == end &&
+                             !tokenizer->eof;
+        if (partial)
+        {
+            tokenizer->position = last->start - tokenizer->buffer;
+            count--;
+        }
+        else
+        {
+            tokenizer->position = cursor - tokenizer->buffer;
+        }
+        // the scan saw the newlines between the words, not the ones left
+        // before or after them
+        const char *gap = scan_start;
+        if (count > 0)
+        {
+            tokenizer->spans[0].starts_line |= tokenizer->line_pending;
+            gap = tokenizer->spans[count - 1].start +
+                  tokenizer->spans[count - 1].length;
+            tokenizer->line_pending = false;
+        }
+        if (has_newline(gap, tokenizer->buffer + tokenizer->position))
+        {
+            tokenizer->line_pending = true;
+        }
+        if (partial && count == 0 &&
+            move_partial_word(tokenizer) == EXIT_FAILURE)
+        {
+            return TOKEN_ERROR;
+        }
+        // every word stops at a delimiter or at the spare byte after
+        // the data, null terminate them in place
+        for (size_t i = 0; i < count; i++)
+        {
+            char *start = (char*)tokenizer->spans[i].start;
+            start[tokenizer->spans[i].length] = '\0';
+        }
+        tokenizer->span_count = count;
+        tokenizer->span_index = 0;
+    }
+}
+
+void tokenizer_free(Tokenizer *tokenizer)
+{
+    free(tokenizer->buffer);
+    tokenizer->buffer = NULL;
+    tokenizer->capacity = tokenizer->position = tokenizer->length = 0;
+}
@@ -0,0 +1,120 @@
+#ifndef _TOKENIZER_H_
+#define _TOKENIZER_H_
+
+#include <stdio.h>   // For FILE
+#include <stddef.h>  // For size_t
+#include <stdbool.h> // for bool
+
+#define DELIMITERS " \n\t\r"
+#define SENTENCE_END '.'
+#define TOKENIZER_BUFFER_SIZE (1 << 16)
+#define TOKENIZER_BATCH 256 // words found by a single scan of the buffer
+#define SCAN_MIN_SPANS 32 // most words that can start in a 64 bytes block
+
+// return values of tokenizer_next()
+#define TOKEN_FOUND 1
+#define TOKEN_END 0
+#define TOKEN_ERROR (-1)
+
+/**
+ * Instruction set used to look for delimiters. TOKENIZER_ISA_AUTO picks the
+ * widest one supported by the running CPU.
+ */
+typedef enum TokenizerIsa {
+    TOKENIZER_ISA_AUTO,
+    TOKENIZER_ISA_SCALAR,
+    TOKENIZER_ISA_SSE2,
+    TOKENIZER_ISA_AVX2
+} TokenizerIsa;
+
+/**
+ * A single word inside a buffer. The word is NOT null terminated unless it
+ * was returned by tokenizer_next().
+ */
+typedef struct TokenSpan {
+    const char *start;
+    size_t length;
+    bool is_last; // true if the word ends a sentence (ends with SENTENCE_END)
+    bool starts_line; // true if a newline comes between the previous word
+                      // and this one. For the first word of scan_tokens()
+                      // only from *cursor on, tokenizer_next() also counts
+                      // the start of the file as a newline
+} TokenSpan;
+
+/**
+ * Streaming tokenizer over a file. Words that cross the boundary of the read
+ * buffer are kept whole, and the buffer grows if a single word is larger
+ * than it.
+ */
+typedef struct Tokenizer {
+    FILE *fp;
+    char *buffer;    // capacity bytes plus one for a terminating '\0'
+    size_t capacity;
+    size_t position; // first byte that was not scanned yet
+    size_t length;   // bytes currently held in buffer
+    bool eof;
+    bool line_pending; // a newline was passed since the last returned word
+    TokenSpan spans[TOKENIZER_BATCH]; // words found but not returned yet
+    size_t span_count;
+    size_t span_index;
+} Tokenizer;
+
+/**
+ * Choose the instruction set used by scan_tokens() and tokenizer_next().
+ * Falls back to a narrower one if the requested one is not supported.
+ * @param isa requested instruction set
+ * @return the instruction set that is actually used
+ */
+TokenizerIsa tokenizer_select_isa(TokenizerIsa isa);
+
+/**
+ * Get the instruction set in use, choosing one first if none was chosen.
+ * Call it before scanning from several threads.
+ * @return the instruction set that is used
+ */
+TokenizerIsa tokenizer_active_isa(void);
+
+/**
+ * @param isa instruction set
+ * @return printable name of isa
+ */
+const char *tokenizer_isa_name(TokenizerIsa isa);
+
+/**
+ * Find words in [*cursor, end), 64 bytes at a time, and advance *cursor
+ * past the last of them. A word that touches end is returned as is.
+ * @param cursor position to scan from, updated to where scanning stopped
+ * @param end end of the buffer
+ * @param spans array of at least max_spans spans to fill
+ * @param max_spans size of spans, larger than SCAN_MIN_SPANS
+ * @return number of words found, 0 only if no word is left
+ */
+size_t scan_tokens(const char **cursor, const char *end, TokenSpan *spans,
+                   size_t max_spans);
+
+/**
+ * Initialize a tokenizer that reads from fp.
+ * @param tokenizer tokenizer to initialize
+ * @param fp file to read from
+ * @param capacity initial size of the read buffer
+ * @return EXIT_SUCCESS or EXIT_FAILURE in case of allocation error
+ */
+int tokenizer_init(Tokenizer *tokenizer, FILE *fp, size_t capacity);
+
+/**
+ * Read the next word from the file. The word is null terminated and stays
+ * valid until the next call.
+ * @param tokenizer
+ * @param span filled with the found word
+ * @return TOKEN_FOUND, TOKEN_END at end of file or TOKEN_ERROR in case of
+ * allocation error
+ */
+int tokenizer_next(Tokenizer *tokenizer, TokenSpan *span);
+
+/**
+ * Free the buffer of the tokenizer. Does not close the file.
+ * @param tokenizer
+ */
+void tokenizer_free(Tokenizer *tokenizer);
+
+#endif //_TOKENIZER_H_
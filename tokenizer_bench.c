@@ -0,0 +1,190 @@
+#define _GNU_SOURCE // For fmemopen()
+#include "bench_utils.h"
+#include "tokenizer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FILE_PATH_ERROR "Error: incorrect file path"
+#define NUM_ARGS_ERROR "Usage: tokenizer_bench <file_path> [megabytes]"
+#define ALLOCATION_ERROR_MASSAGE "Allocation failure: Failed to allocate new memory\n"
+#define DEFAULT_MEGABYTES 64
+#define MEGABYTE (1024 * 1024)
+#define GIGABYTE 1e9
+#define LINE_SIZE 1000
+#define REPEATS 3
+#define DECIMAL 10
+#define ARGS_WITH_OPTIONAL 3
+#define ARGS_WITHOUT_OPTIONAL 2
+
+/**
+ * Totals of a tokenization pass, used to check that the passes agree and
+ * to keep the compiler from dropping the work.
+ */
+typedef struct TokenStats {
+    long tokens;
+    long bytes;
+    long last_tokens;
+} TokenStats;
+
+/**
+ * The original path of fill_database: fgets into a 1000 bytes buffer,
+ * strtok and strlen for every word.
+ */
+static TokenStats run_strtok(char *data, const size_t size)
+{
+    TokenStats stats = {0, 0, 0};
+    char buffer[LINE_SIZE];
+    FILE *fp = fmemopen(data, size, "r");
+    while (fgets(buffer, LINE_SIZE, fp) != NULL)
+    {
+        char *token = strtok(buffer, DELIMITERS);
+        while (token != NULL)
+        {
+            const size_t len = strlen(token);
+            stats.tokens++;
+            stats.bytes += len;
+            stats.last_tokens += token[len - 1] == SENTENCE_END;
+            token = strtok(NULL, DELIMITERS);
+        }
+    }
+    fclose(fp);
+    return stats;
+}
+
+/**
+ * fill_database's path: streaming tokenizer over the same stdio source.
+ */
+static TokenStats run_tokenizer(char *data, const size_t size)
+{
+    TokenStats stats = {0, 0, 0};
+    FILE *fp = fmemopen(data, size, "r");
+    Tokenizer tokenizer;
+    if (tokenizer_init(&tokenizer, fp, TOKENIZER_BUFFER_SIZE) == EXIT_FAILURE)
+    {
+        fclose(fp);
+        return stats;
+    }
+    TokenSpan span;
+    while (tokenizer_next(&tokenizer, &span) == TOKEN_FOUND)
+    {
+        stats.tokens++;
+        stats.bytes += span.length;
+        stats.last_tokens += span.is_last;
+    }
+    tokenizer_free(&tokenizer);
+    fclose(fp);
+    return stats;
+}
+
+/**
+ * scan_tokens directly over memory, without stdio.
+ */
+static TokenStats run_scan(char *data, const size_t size)
+{
+    TokenStats stats = {0, 0, 0};
+    const char *cursor = data;
+    TokenSpan spans[TOKENIZER_BATCH];
+    size_t count;
+    while ((count = scan_tokens(&cursor, data + size, spans,
+                                TOKENIZER_BATCH)) > 0)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            stats.tokens++;
+            stats.bytes += spans[i].length;
+            stats.last_tokens += spans[i].is_last;
+        }
+    }
+    return stats;
+}
+
+static void report(const char *name, TokenStats (*run)(char *, size_t),
+                   const char *source, char *work, const size_t size)
+{
+    double best = 0;
+    TokenStats stats = {0, 0, 0};
+    for (int i = 0; i < REPEATS; i++)
+    {
+        // strtok writes into the data, so every pass gets a fresh copy
+        memcpy(work, source, size);
+        const double start = now_seconds();
+        stats = run(work, size);
+        const double seconds = now_seconds() - start;
+        if (i == 0 || seconds < best)
+        {
+            best = seconds;
+        }
+    }
+    printf("%-18s %8.3f GB/s  %10ld tokens  %10ld last  %12ld bytes\n",
+           name, size / best / GIGABYTE, stats.tokens, stats.last_tokens,
+           stats.bytes);
+}
+
+int main(const int argc, char *argv[])
+{
+    if (argc < ARGS_WITHOUT_OPTIONAL || argc > ARGS_WITH_OPTIONAL)
+    {
+        printf(NUM_ARGS_ERROR);
+        return EXIT_FAILURE;
+    }
+    size_t megabytes = DEFAULT_MEGABYTES;
+    if (argc == ARGS_WITH_OPTIONAL)
+    {
+        megabytes = strtol(argv[2], NULL, DECIMAL);
+    }
+    FILE *file = fopen(argv[1], "r");
+    if (file == NULL)
+    {
+        printf(FILE_PATH_ERROR);
+        return EXIT_FAILURE;
+    }
+    fseek(file, 0, SEEK_END);
+    const long file_size = ftell(file);
+    rewind(file);
+    const size_t size = megabytes * MEGABYTE;
+    char *source = malloc(size);
+    char *work = malloc(size);
+    if (file_size <= 0 || source == NULL || work == NULL)
+    {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        fclose(file);
+        free(source);
+        free(work);
+        return EXIT_FAILURE;
+    }
+    // repeat the file until the requested size is reached
+    size_t filled = fread(source, 1,
+                          file_size < (long)size ? (size_t)file_size : size,
+                          file);
+    fclose(file);
+    while (filled < size)
+    {
+        const size_t chunk = filled < size - filled ? filled : size - filled;
+        memcpy(source + filled, source, chunk);
+        filled += chunk;
+    }
+
+    printf("input: %zu MB\n", megabytes);
+    report("strtok", run_strtok, source, work, size);
+    const TokenizerIsa isas[] = {
+        TOKENIZER_ISA_SCALAR, TOKENIZER_ISA_SSE2, TOKENIZER_ISA_AVX2
+    };
+    for (size_t i = 0; i < sizeof(isas) / sizeof(isas[0]); i++)
+    {
+        if (tokenizer_select_isa(isas[i]) != isas[i])
+        {
+            printf("%-18s not supported\n", tokenizer_isa_name(isas[i]));
+            continue;
+        }
+        char name[32];
+        snprintf(name, sizeof(name), "tokenizer/%s",
+                 tokenizer_isa_name(isas[i]));
+        report(name, run_tokenizer, source, work, size);
+        snprintf(name, sizeof(name), "scan/%s", tokenizer_isa_name(isas[i]));
+        report(name, run_scan, source, work, size);
+    }
+    free(source);
+    free(work);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+#include <limits.h>
+#include "markov_chain.h"
+#include "markov_csr.h"
+#include "markov_external.h"
+#include "tweets_database.h"
+#include "bench_utils.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+#define NUM_ARGS_ERROR "Usage: train_model <corpus_file> <model_file> [memory_budget_kb]"
+#define KILOBYTE 1024
+#define DECIMAL 10
+#define MIN_ARGS 3
+#define CORPUS_ARG 1
+#define MODEL_ARG 2
+#define BUDGET_ARG 3
+#define MAX_ARGS 4
+
+/**
+ * Train a chain of words in memory and write it as a model file.
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int train_in_memory(FILE *input, FILE *output)
+{
+    CsrMarkovChain csr_chain;
+    if (fill_csr_chain(input, INT_MAX, &csr_chain) == EXIT_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+    const int written = write_csr_chain(output, &csr_chain);
+    free_csr_chain(&csr_chain);
+    return written;
+}
+
+/**
+ * Read back a model file and print its size.
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int check_model(const char *file_path)
+{
+    FILE *file = fopen(file_path, "rb");
+    if (file == NULL)
+    {
+        printf(FILE_PATH_ERROR);
+        return EXIT_FAILURE;
+    }
+    CsrMarkovChain csr_chain;
+    const int res = read_csr_chain(file, &csr_chain);
+    fclose(file);
+    if (res == EXIT_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+    printf("states %d  transitions %d\n", csr_chain.size,
+           csr_chain.offsets[csr_chain.size]);
+    free_csr_chain(&csr_chain);
+    return EXIT_SUCCESS;
+}
+
+int main(const int argc, char *argv[])
+{
+    if (argc < MIN_ARGS || argc > MAX_ARGS)
+    {
+        printf(NUM_ARGS_ERROR);
+        return EXIT_FAILURE;
+    }
+    const long budget_kb = argc > BUDGET_ARG
+                               ? strtol(argv[BUDGET_ARG], NULL, DECIMAL)
+                               : 0;
+    if (budget_kb < 0)
+    {
+        printf(NUM_ARGS_ERROR);
+        return EXIT_FAILURE;
+    }
+    FILE *input = fopen(argv[CORPUS_ARG], "r");
+    if (input == NULL)
+    {
+        printf(FILE_PATH_ERROR);
+        return EXIT_FAILURE;
+    }
+    // "w+b" since train_external() seeks back to finish the header
+    FILE *output = fopen(argv[MODEL_ARG], "w+b");
+    if (output == NULL)
+    {
+        fclose(input);
+        printf(FILE_PATH_ERROR);
+        return EXIT_FAILURE;
+    }
+    const double start = now_seconds();
+    int res = budget_kb == 0
+                  ? train_in_memory(input, output)
+                  : train_external(input, output, budget_kb * KILOBYTE);
+    fclose(input);
+    if (fclose(output) != 0)
+    {
+        res = EXIT_FAILURE;
+    }
+    if (res == EXIT_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+    printf("%s training took %.3f sec\n",
+           budget_kb == 0 ? "in memory" : "external", now_seconds() - start);
+    return check_model(argv[MODEL_ARG]);
+}
@@ -0,0 +1,142 @@
+#include "tweets_database.h"
+#include "tokenizer.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+void print_word(void* word)
+{
+    char* char_word = word;
+    printf("%s", char_word);
+}
+
+int comp_words(void* first_word, void* second_word)
+{
+    const char* first_char = first_word;
+    const char* second_char = second_word;
+    return strcmp(first_char, second_char);
+}
+
+void free_word(void* word)
+{
+    free(word);
+}
+
+void* copy_word(void* word)
+{
+    char* copy = malloc(strlen(word) + 1);
+    if (copy == NULL)
+    {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        return NULL;
+    }
+    strcpy(copy, word);
+    return copy;
+}
+
+bool end_with_dot(void* word)
+{
+    const char* char_word = word;
+    const int len = strlen(char_word);
+    if (char_word[len - 1] == '.')
+    {
+        return true;
+    }
+    return false;
+}
+
+// Function to fill the database with words from the file
+int fill_database(FILE* fp, int words_to_read, MarkovChain* markov_chain)
+{
+    Tokenizer tokenizer;
+    if (tokenizer_init(&tokenizer, fp, TOKENIZER_BUFFER_SIZE) == EXIT_FAILURE)
+    {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        return EXIT_FAILURE;
+    }
+    TokenSpan span;
+    int status;
+    const Node* prev_node = NULL;
+    // Read words from file, the tokenizer already knows if a word ends
+    // a sentence so is_last_ptr is not called here
+    while ((status = tokenizer_next(&tokenizer, &span)) == TOKEN_FOUND)
+    {
+        // Like reading line by line, finish the line on which the words
+        // ran out
+        if (words_to_read <= 0 && span.starts_line)
+        {
+            break;
+        }
+        // Add token to database
+        const Node* added_node = add_to_database(markov_chain,
+                                                 (void*)span.start);
+        if (added_node == NULL)
+        {
+            tokenizer_free(&tokenizer);
+            free_markov_chain(&markov_chain);
+            return EXIT_FAILURE;
+        }
+        // prev_node is never the end of a sentence, see below
+        if (prev_node != NULL)
+        {
+            if (add_node_to_frequency_list(prev_node->data,
+                                           added_node->data, markov_chain) == EXIT_FAILURE)
+            {
+                tokenizer_free(&tokenizer);
+                free_markov_chain(&markov_chain);
+                return EXIT_FAILURE;
+            }
+        }
+        prev_node = added_node;
+        words_to_read--;
+        // If it's the end of a sentence, reset prev_node
+        if (span.is_last)
+        {
+            if (words_to_read <= 0)
+            {
+                break;
+            }
+            prev_node = NULL;
+        }
+    }
+    tokenizer_free(&tokenizer);
+    if (status == TOKEN_ERROR)
+    {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        free_markov_chain(&markov_chain);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int fill_csr_chain(FILE* fp, int words_to_read, CsrMarkovChain* csr_chain)
+{
+    LinkedList link_list = {NULL, NULL, 0};
+    MarkovChain markov_chain = {
+        &link_list, print_word, comp_words,
+        free_word, copy_word, end_with_dot
+    };
+    MarkovChain* markov_chain_ptr = &markov_chain;
+    if (fill_database(fp, words_to_read, &markov_chain) == EXIT_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+    // build_csr_chain() reports its own allocation errors
+    const int built = build_csr_chain(&markov_chain, csr_chain);
+    free_markov_chain(&markov_chain_ptr);
+    return built;
+}
+
+int train_csr_chain(const char* file_path, CsrMarkovChain* csr_chain)
+{
+    FILE* file = fopen(file_path, "r");
+    if (file == NULL)
+    {
+        printf(FILE_PATH_ERROR);
+        return EXIT_FAILURE;
+    }
+    const int res = fill_csr_chain(file, INT_MAX, csr_chain);
+    fclose(file);
+    return res;
+}
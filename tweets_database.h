@@ -0,0 +1,39 @@
+#ifndef _TWEETS_DATABASE_H_
+#define _TWEETS_DATABASE_H_
+
+#include "markov_chain.h"
+#include "markov_csr.h"
+
+#define FILE_PATH_ERROR "Error: incorrect file path"
+
+/**
+ * Fill the database of a chain of words with the words of a file. The
+ * chain should use the word functions declared in markov_chain.h.
+ * @param fp file to read words from
+ * @param words_to_read number of words to read, reading stops at the end
+ * of the line or of the sentence on which they run out, whichever is first
+ * @param markov_chain chain to fill, freed in case of failure
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int fill_database(FILE* fp, int words_to_read, MarkovChain* markov_chain);
+
+/**
+ * Fill a chain of words with the words of a file, like fill_database(), and
+ * build its contiguous form.
+ * @param fp file to read words from
+ * @param words_to_read number of words to read, like in fill_database()
+ * @param csr_chain chain to fill
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int fill_csr_chain(FILE* fp, int words_to_read, CsrMarkovChain* csr_chain);
+
+/**
+ * Fill a chain of words with all the words of a file, like fill_csr_chain().
+ * @param file_path file to read words from
+ * @param csr_chain chain to fill
+ * @return EXIT_SUCCESS or EXIT_FAILURE, printing FILE_PATH_ERROR if the
+ * file can't be opened
+ */
+int train_csr_chain(const char* file_path, CsrMarkovChain* csr_chain);
+
+#endif //_TWEETS_DATABASE_H_
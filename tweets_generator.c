@@ -1,65 +1,75 @@
 #include <limits.h>
 #include "markov_chain.h"
+#include "tweets_database.h"
+#include "markov_reach.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
-#define FILE_PATH_ERROR "Error: incorrect file path"
 #define NUM_ARGS_ERROR "Usage: invalid number of arguments"
-#define BUFFER_SIZE 1000
 #define MAX_WORDS_IN_TWEET 20
 #define DECIMAL 10
+#define ARGS_WITH_MODE 6
 #define ARGS_WITH_OPTIONAL 5
 #define ARGS_WITHOUT_OPTIONAL 4
-#define DELIMITERS " \n\t\r"
+#define COMPLETE_MODE "complete"
+#define NO_COMPLETE_TWEET_ERROR "Error: no tweet can end within the limit"
 
-void print_word(void* word)
+/**
+ * Generate tweets that all end with a last word within MAX_WORDS_IN_TWEET
+ * words, from the contiguous form of the chain.
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int generate_complete_tweets(FILE* file, const int words_number,
+                                    const unsigned int tweets_number)
 {
-    char* char_word = word;
-    printf("%s", char_word);
-}
-
-int comp_words(void* first_word, void* second_word)
-{
-    const char* first_char = first_word;
-    const char* second_char = second_word;
-    return strcmp(first_char, second_char);
-}
-
-void free_word(void* word)
-{
-    free(word);
-}
-
-void* copy_word(void* word)
-{
-    char* copy = malloc(strlen(word) + 1);
-    if (copy == NULL)
+    CsrMarkovChain csr_chain;
+    if (fill_csr_chain(file, words_number, &csr_chain) == EXIT_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+    // relayout_csr_chain() reports its own allocation errors
+    if (relayout_csr_chain(&csr_chain) == EXIT_FAILURE)
+    {
+        free_csr_chain(&csr_chain);
+        return EXIT_FAILURE;
+    }
+    ReachTable reach_table;
+    if (build_reach_table(&reach_table, &csr_chain,
+                          MAX_WORDS_IN_TWEET) == EXIT_FAILURE)
     {
         printf(ALLOCATION_ERROR_MASSAGE);
-        return NULL;
+        free_csr_chain(&csr_chain);
+        return EXIT_FAILURE;
     }
-    strcpy(copy, word);
-    return copy;
-}
-
-bool end_with_dot(void* word)
-{
-    const char* char_word = word;
-    const int len = strlen(char_word);
-    if (char_word[len - 1] == '.')
+    if (reach_table.first_count == 0)
     {
-        return true;
+        printf(NO_COMPLETE_TWEET_ERROR);
+        free_reach_table(&reach_table);
+        free_csr_chain(&csr_chain);
+        return EXIT_FAILURE;
     }
-    return false;
+    int sequence[MAX_WORDS_IN_TWEET];
+    for (unsigned int i = 1; i <= tweets_number; i++)
+    {
+        const int length = generate_finishing_sequence(&reach_table,
+                                                       sequence);
+        printf("Tweet %d: ", i);
+        for (int j = 0; j < length; j++)
+        {
+            print_word(csr_chain.data[sequence[j]]);
+            printf(j < length - 1 ? " " : "\n");
+        }
+    }
+    free_reach_table(&reach_table);
+    free_csr_chain(&csr_chain);
+    return EXIT_SUCCESS;
 }
 
-// Function declaration
-int fill_database(FILE* fp, int words_to_read, MarkovChain* markov_chain);
-
 // Main function
 int main(const int argc, char* argv[])
 {
-    if (argc < ARGS_WITHOUT_OPTIONAL || argc > ARGS_WITH_OPTIONAL)
+    if (argc < ARGS_WITHOUT_OPTIONAL || argc > ARGS_WITH_MODE ||
+        (argc == ARGS_WITH_MODE && strcmp(argv[5], COMPLETE_MODE) != 0))
     {
         printf(NUM_ARGS_ERROR);
         return EXIT_FAILURE;
@@ -69,7 +79,7 @@ int main(const int argc, char* argv[])
     const unsigned int tweets_number = strtol(argv[2], NULL, DECIMAL);
     const char* file_path = argv[3];
     int words_number = INT_MAX;
-    if (argc == ARGS_WITH_OPTIONAL)
+    if (argc >= ARGS_WITH_OPTIONAL)
     {
         words_number = strtol(argv[4], NULL, DECIMAL);
     }
@@ -79,6 +89,13 @@ int main(const int argc, char* argv[])
         printf(FILE_PATH_ERROR);
         return EXIT_FAILURE;
     }
+    if (argc == ARGS_WITH_MODE)
+    {
+        const int res = generate_complete_tweets(file, words_number,
+                                                 tweets_number);
+        fclose(file);
+        return res;
+    }
     LinkedList link_list = {NULL, NULL, 0};
     MarkovChain markov_chain = {
         &link_list, print_word, comp_words,
@@ -101,55 +118,3 @@ int main(const int argc, char* argv[])
     free_markov_chain(&markov_chain_ptr);
     return EXIT_SUCCESS;
 }
-
-// Function to fill the database with words from the file
-int fill_database(FILE* fp, int words_to_read, MarkovChain* markov_chain)
-{
-    char buffer[BUFFER_SIZE] = {0};
-    char* token = NULL;
-    const Node* prev_node = NULL;
-    // Read lines from file
-    while (fgets(buffer, BUFFER_SIZE, fp) != NULL && words_to_read > 0)
-    {
-        token = strtok(buffer, DELIMITERS); // Tokenize line
-        while (token != NULL)
-        {
-            // Add token to database
-            const Node* added_node = add_to_database(markov_chain, token);
-            if (added_node == NULL)
-            {
-                free_markov_chain(&markov_chain);
-                markov_chain = NULL;
-                return EXIT_FAILURE;
-            }
-            // Add node to frequency list if it's not the end of a sentence
-            if (prev_node != NULL)
-            {
-                const char* word = prev_node->data->data;
-                if (!(markov_chain->is_last_ptr((void*)word)))
-                {
-                    if (add_node_to_frequency_list(prev_node->data,
-                                                   added_node->data, markov_chain) == EXIT_FAILURE)
-                    {
-                        free_markov_chain(&markov_chain);
-                        return EXIT_FAILURE;
-                    }
-                }
-            }
-            prev_node = added_node;
-            words_to_read--;
-            // If it's the end of a sentence, reset prev_node
-            const char* word = prev_node->data->data;
-            if (markov_chain->is_last_ptr((void*)word))
-            {
-                if (words_to_read <= 0)
-                {
-                    return EXIT_SUCCESS;
-                }
-                prev_node = NULL;
-            }
-            token = strtok(NULL, DELIMITERS); // Get next token
-        }
-    }
-    return EXIT_SUCCESS;
-}
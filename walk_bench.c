@@ -0,0 +1,254 @@
+#include "markov_csr.h"
+#include "bench_utils.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define NUM_ARGS_ERROR "Usage: walk_bench [states] [steps]"
+#define DEFAULT_STATES 1000000
+#define DEFAULT_STEPS 20000000
+#define WALK_LENGTH 20 // like MAX_WORDS_IN_TWEET, then a new random start
+#define MAX_DEGREE 512
+#define MAX_FREQUENCY 1000
+#define SEED 1234
+#define DECIMAL 10
+#define STATES_ARG 1
+#define STEPS_ARG 2
+#define MAX_ARGS 3
+#define NO_COUNTER (-1)
+
+/**
+ * Hardware counters of a measured section, NO_COUNTER where not available.
+ */
+typedef struct Counters {
+    int cache_misses;
+    int l1_misses;
+} Counters;
+
+static int comp_edges(const void *first, const void *second)
+{
+    return ((const CsrEdge*)first)->successor -
+           ((const CsrEdge*)second)->successor;
+}
+
+/**
+ * Generate a chain with power law out degrees and transition frequencies,
+ * where a few popular states receive most transitions. Popular states get
+ * random numbers, like words numbered by first appearance. Like
+ * build_csr_chain(), a state lists every successor once, sorted by
+ * successor.
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+static int generate_chain(CsrMarkovChain *csr_chain, const int size)
+{
+    uint64_t random = SEED;
+    int *popular = malloc(size * sizeof(int));
+    *csr_chain = (CsrMarkovChain){
+        size, calloc(size, sizeof(void*)), calloc(size, sizeof(bool)),
+        malloc((size + 1) * sizeof(int)), NULL, malloc(size * sizeof(long)),
+        free
+    };
+    if (popular == NULL || csr_chain->data == NULL ||
+        csr_chain->is_last == NULL || csr_chain->offsets == NULL ||
+        csr_chain->totals == NULL)
+    {
+        free(popular);
+        free_csr_chain(csr_chain);
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < size; i++)
+    {
+        popular[i] = i;
+    }
+    for (int i = size - 1; i > 0; i--)
+    {
+        const int j = next_random(&random) % (i + 1);
+        const int temp = popular[i];
+        popular[i] = popular[j];
+        popular[j] = temp;
+    }
+    csr_chain->offsets[0] = 0;
+    for (int i = 0; i < size; i++)
+    {
+        int degree = (int)pow(next_uniform(&random) + 1e-9, -1.0);
+        degree = degree > MAX_DEGREE ? MAX_DEGREE : degree;
+        csr_chain->offsets[i + 1] = csr_chain->offsets[i] + degree;
+    }
+    csr_chain->edges = malloc((csr_chain->offsets[size] + 1) * sizeof(CsrEdge));
+    if (csr_chain->edges == NULL)
+    {
+        free(popular);
+        free_csr_chain(csr_chain);
+        return EXIT_FAILURE;
+    }
+    // repeated successors are merged, so the edges only move backwards
+    int start = 0, kept = 0;
+    for (int i = 0; i < size; i++)
+    {
+        const int end = csr_chain->offsets[i + 1];
+        long total = 0;
+        for (int j = start; j < end; j++)
+        {
+            const double rank = pow(next_uniform(&random), 4);
+            const int frequency =
+                1 + (int)(MAX_FREQUENCY * pow(next_uniform(&random), 8));
+            csr_chain->edges[j] = (CsrEdge){
+                popular[(int)(rank * (size - 1))], frequency
+            };
+            total += frequency;
+        }
+        qsort(csr_chain->edges + start, end - start, sizeof(CsrEdge),
+              comp_edges);
+        for (int j = start; j < end; j++)
+        {
+            if (kept > csr_chain->offsets[i] &&
+                csr_chain->edges[kept - 1].successor ==
+                csr_chain->edges[j].successor)
+            {
+                csr_chain->edges[kept - 1].frequency +=
+                    csr_chain->edges[j].frequency;
+            }
+            else
+            {
+                csr_chain->edges[kept++] = csr_chain->edges[j];
+            }
+        }
+        csr_chain->offsets[i + 1] = kept;
+        csr_chain->totals[i] = total;
+        start = end;
+    }
+    free(popular);
+    return EXIT_SUCCESS;
+}
+
+#ifdef __linux__
+static int open_counter(const uint32_t type, const uint64_t config)
+{
+    struct perf_event_attr attr = {0};
+    attr.type = type;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+static Counters start_counters(void)
+{
+    Counters counters = {NO_COUNTER, NO_COUNTER};
+#ifdef __linux__
+    counters.cache_misses = open_counter(PERF_TYPE_HARDWARE,
+                                         PERF_COUNT_HW_CACHE_MISSES);
+    counters.l1_misses = open_counter(
+        PERF_TYPE_HW_CACHE,
+        PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 |
+        PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    if (counters.cache_misses != NO_COUNTER)
+    {
+        ioctl(counters.cache_misses, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    if (counters.l1_misses != NO_COUNTER)
+    {
+        ioctl(counters.l1_misses, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+    return counters;
+}
+
+/**
+ * Stop a counter and print its value per step.
+ */
+static void print_counter(const char *name, const int counter,
+                          const long steps)
+{
+    uint64_t value = 0;
+#ifdef __linux__
+    if (counter != NO_COUNTER)
+    {
+        ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(counter, &value, sizeof(value)) == sizeof(value))
+        {
+            printf("  %s %.3f/step", name, (double)value / steps);
+        }
+        close(counter);
+        return;
+    }
+#endif
+    (void)value;
+    (void)steps;
+    printf("  %s n/a", name);
+}
+
+static void run_walks(const char *name, const CsrMarkovChain *csr_chain,
+                      const long steps)
+{
+    srand(SEED);
+    long checksum = 0;
+    int state = 0;
+    Counters counters = start_counters();
+    const double start = now_seconds();
+    for (long i = 0; i < steps; i++)
+    {
+        if (i % WALK_LENGTH == 0)
+        {
+            state = rand() % csr_chain->size;
+        }
+        const int next = get_next_random_state(csr_chain, state);
+        state = next == -1 ? rand() % csr_chain->size : next;
+        checksum += state;
+    }
+    const double seconds = now_seconds() - start;
+    printf("%-9s %12.0f steps/sec", name, steps / seconds);
+    print_counter("cache-misses", counters.cache_misses, steps);
+    print_counter("L1d-misses", counters.l1_misses, steps);
+    // keep the walks from being optimized away
+    printf("  (checksum %ld)\n", checksum % DECIMAL);
+}
+
+int main(const int argc, char *argv[])
+{
+    if (argc > MAX_ARGS)
+    {
+        printf(NUM_ARGS_ERROR);
+        return EXIT_FAILURE;
+    }
+    const int size = argc > STATES_ARG
+                         ? strtol(argv[STATES_ARG], NULL, DECIMAL)
+                         : DEFAULT_STATES;
+    const long steps = argc > STEPS_ARG
+                           ? strtol(argv[STEPS_ARG], NULL, DECIMAL)
+                           : DEFAULT_STEPS;
+    if (size < 1 || steps < 1)
+    {
+        printf(NUM_ARGS_ERROR);
+        return EXIT_FAILURE;
+    }
+    CsrMarkovChain csr_chain;
+    if (generate_chain(&csr_chain, size) == EXIT_FAILURE)
+    {
+        printf(ALLOCATION_ERROR_MASSAGE);
+        return EXIT_FAILURE;
+    }
+    printf("states %d  transitions %d  steps %ld\n", csr_chain.size,
+           csr_chain.offsets[csr_chain.size], steps);
+    run_walks("before", &csr_chain, steps);
+    const double start = now_seconds();
+    if (relayout_csr_chain(&csr_chain) == EXIT_FAILURE)
+    {
+        free_csr_chain(&csr_chain);
+        return EXIT_FAILURE;
+    }
+    printf("relayout took %.3f sec\n", now_seconds() - start);
+    run_walks("after", &csr_chain, steps);
+    free_csr_chain(&csr_chain);
+    return EXIT_SUCCESS;
+}
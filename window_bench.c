@@ -0,0 +1,199 @@
+#include "markov_window.h"
+#include "bench_utils.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define NUM_ARGS_ERROR "Usage: window_bench [periods] [words_per_period] [buckets]"
+#define DEFAULT_PERIODS 100
+#define DEFAULT_PERIOD_WORDS 200000
+#define DEFAULT_BUCKETS 12
+#define VOCABULARY 1000000
+#define ZIPF_EXPONENT 1.1
+#define DRIFT 5000        // ranks the popular words move by every period
+#define SENTENCE_RATE 12  // one word in SENTENCE_RATE ends a sentence
+#define SAMPLE_STEPS 100000
+#define REPORT_PERIODS 10
+#define MAX_WORD 32
+#define SEED 1234
+#define DECIMAL 10
+#define MEGABYTE (1024.0 * 1024.0)
+#define PERIODS_ARG 1
+#define WORDS_ARG 2
+#define BUCKETS_ARG 3
+#define MAX_ARGS 4
+
+/**
+ * Running sums of the Zipf probabilities of ranks 1..VOCABULARY.
+ * @return newly allocated table, or NULL in case of allocation error
+ */
+static double *zipf_table(void)
+{
+    double *table = malloc(VOCABULARY * sizeof(double));
+    if (table == NULL)
+    {
+        return NULL;
+    }
+    double sum = 0;
+    for (int i = 0; i < VOCABULARY; i++)
+    {
+        sum += pow(i + 1, -ZIPF_EXPONENT);
+        table[i] = sum;
+    }
+    for (int i = 0; i < VOCABULARY; i++)
+    {
+        table[i] /= sum;
+    }
+    return table;
+}
+
+static int zipf_rank(const double *table, const double uniform)
+{
+    int low = 0, high = VOCABULARY - 1;
+    while (low < high)
+    {
+        const int middle = (low + high) / 2;
+        if (table[middle] > uniform)
+        {
+            high = middle;
+        }
+        else
+        {
+            low = middle + 1;
+        }
+    }
+    return low;
+}
+
+/**
+ * Generate the words of a period, where the popular words change over time
+ * like trending hashtags.
+ * @param words period_words words of MAX_WORD bytes to fill
+ * @param is_last whether every word ends a sentence
+ */
+static void generate_period(const double *table, uint64_t *random,
+                            const long period, char *words, bool *is_last,
+                            const long period_words)
+{
+    const long drift = period * DRIFT;
+    for (long i = 0; i < period_words; i++)
+    {
+        const int rank = zipf_rank(table, next_uniform(random));
+        is_last[i] = next_random(random) % SENTENCE_RATE == 0;
+        snprintf(words + i * MAX_WORD, MAX_WORD, "w%ld%s",
+                 (rank + drift) % VOCABULARY, is_last[i] ? "." : "");
+    }
+}
+
+/**
+ * Walk from random first states, so the sampling tables of the states
+ * changed in the last period are rebuilt.
+ * @return time per step in ns
+ */
+static double sample(WindowChain *window_chain)
+{
+    const double start = now_seconds();
+    int state = NO_STATE;
+    for (int i = 0; i < SAMPLE_STEPS; i++)
+    {
+        if (state == NO_STATE)
+        {
+            state = get_first_window_state(window_chain);
+        }
+        else
+        {
+            state = get_next_window_state(window_chain, state);
+        }
+    }
+    return (now_seconds() - start) * 1e9 / SAMPLE_STEPS;
+}
+
+int main(const int argc, char *argv[])
+{
+    if (argc > MAX_ARGS)
+    {
+        printf(NUM_ARGS_ERROR);
+        return EXIT_FAILURE;
+    }
+    const long periods = argc > PERIODS_ARG
+                             ? strtol(argv[PERIODS_ARG], NULL, DECIMAL)
+                             : DEFAULT_PERIODS;
+    const long period_words = argc > WORDS_ARG
+                                  ? strtol(argv[WORDS_ARG], NULL, DECIMAL)
+                                  : DEFAULT_PERIOD_WORDS;
+    const int buckets = argc > BUCKETS_ARG
+                            ? strtol(argv[BUCKETS_ARG], NULL, DECIMAL)
+                            : DEFAULT_BUCKETS;
+    if (periods < 1 || period_words < 1 || buckets < 1)
+    {
+        printf(NUM_ARGS_ERROR);
+        return EXIT_FAILURE;
+    }
+    double *table = zipf_table();
+    char *words = malloc(period_words * MAX_WORD);
+    bool *is_last = malloc(period_words * sizeof(bool));
+    WindowChain window_chain;
+    if (table == NULL || words == NULL || is_last == NULL ||
+        init_window_chain(&window_chain, buckets) == EXIT_FAILURE)
+    {
+        free(table);
+        free(words);
+        free(is_last);
+        printf(ALLOCATION_ERROR_MASSAGE);
+        return EXIT_FAILURE;
+    }
+    int res = EXIT_SUCCESS;
+    srand(SEED);
+    uint64_t random = SEED;
+    double add_seconds = 0, expire_seconds = 0, sample_ns = 0;
+    long measured = 0; // periods since the last report
+    printf("vocabulary %d  words/period %ld  buckets %d\n", VOCABULARY,
+           period_words, buckets);
+    for (long period = 1; period <= periods && res == EXIT_SUCCESS; period++)
+    {
+        generate_period(table, &random, period, words, is_last, period_words);
+        double start = now_seconds();
+        for (long i = 0; i < period_words && res == EXIT_SUCCESS; i++)
+        {
+            const char *word = words + i * MAX_WORD;
+            if (window_add_word(&window_chain, word, strlen(word),
+                                is_last[i]) == NO_STATE)
+            {
+                res = EXIT_FAILURE;
+            }
+        }
+        add_seconds += now_seconds() - start;
+        sample_ns += sample(&window_chain);
+        start = now_seconds();
+        if (res == EXIT_FAILURE ||
+            advance_window(&window_chain) == EXIT_FAILURE)
+        {
+            printf(ALLOCATION_ERROR_MASSAGE);
+            res = EXIT_FAILURE;
+            break;
+        }
+        expire_seconds += now_seconds() - start;
+        measured++;
+        if (period % REPORT_PERIODS == 0 || period == periods)
+        {
+            const long events = measured * period_words;
+            const int live = window_chain.index.count -
+                             window_chain.index.free_count;
+            printf("period %4ld  words %8d  transitions %9zu  memory %8.1f MB"
+                   "  add %6.1f ns  expire %6.1f ns  sample %6.1f ns\n",
+                   period, live, window_chain.edge_count,
+                   window_chain_memory(&window_chain) / MEGABYTE,
+                   add_seconds * 1e9 / events, expire_seconds * 1e9 / events,
+                   sample_ns / measured);
+            add_seconds = expire_seconds = sample_ns = 0;
+            measured = 0;
+        }
+    }
+    free(table);
+    free(words);
+    free(is_last);
+    free_window_chain(&window_chain);
+    return res;
+}
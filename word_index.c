@@ -0,0 +1,201 @@
+#include "word_index.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_CAPACITY 16
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+/**
+ * FNV-1a hash of length bytes.
+ */
+static uint64_t hash_word(const char *word, const size_t length)
+{
+    uint64_t hash = FNV_OFFSET;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash = (hash ^ (unsigned char)word[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+static int word_equals(const char *stored, const char *word,
+                       const size_t length)
+{
+    return strncmp(stored, word, length) == 0 && stored[length] == '\0';
+}
+
+/**
+ * Find the slot holding word, or the empty slot where it should go.
+ */
+static size_t find_slot(const WordIndex *index, const char *word,
+                        const size_t length)
+{
+    const size_t mask = index->capacity - 1;
+    size_t slot = hash_word(word, length) & mask;
+    while (index->slots[slot] != WORD_NOT_FOUND &&
+           !word_equals(index->words[index->slots[slot]], word, length))
+    {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+static int alloc_slots(WordIndex *index, const size_t capacity)
+{
+    int *slots = malloc(capacity * sizeof(int));
+    if (slots == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < capacity; i++)
+    {
+        slots[i] = WORD_NOT_FOUND;
+    }
+    free(index->slots);
+    index->slots = slots;
+    index->capacity = capacity;
+    return EXIT_SUCCESS;
+}
+
+int init_word_index(WordIndex *index, const size_t expected)
+{
+    *index = (WordIndex){NULL, 0, NULL, 0, 0, NULL, 0, 0};
+    size_t capacity = MIN_CAPACITY;
+    // keep the table at most half full
+    while (capacity < 2 * expected)
+    {
+        capacity *= 2;
+    }
+    return alloc_slots(index, capacity);
+}
+
+/**
+ * Double the number of slots and put every word in its new slot.
+ */
+static int grow_slots(WordIndex *index)
+{
+    if (alloc_slots(index, 2 * index->capacity) == EXIT_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+    for (int id = 0; id < index->count; id++)
+    {
+        const char *word = index->words[id];
+        if (word != NULL)
+        {
+            index->slots[find_slot(index, word, strlen(word))] = id;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+int word_index_add(WordIndex *index, const char *word, const size_t length)
+{
+    size_t slot = find_slot(index, word, length);
+    if (index->slots[slot] != WORD_NOT_FOUND)
+    {
+        return index->slots[slot];
+    }
+    const bool reused = index->free_count > 0;
+    if (!reused && index->count == index->words_capacity)
+    {
+        const int words_capacity = index->words_capacity == 0
+                                       ? MIN_CAPACITY
+                                       : 2 * index->words_capacity;
+        char **temp = realloc(index->words, words_capacity * sizeof(char*));
+        if (temp == NULL)
+        {
+            return WORD_NOT_FOUND;
+        }
+        index->words = temp;
+        index->words_capacity = words_capacity;
+    }
+    char *copy = malloc(length + 1);
+    if (copy == NULL)
+    {
+        return WORD_NOT_FOUND;
+    }
+    memcpy(copy, word, length);
+    copy[length] = '\0';
+    const int id = reused ? index->free_ids[--index->free_count]
+                          : index->count++;
+    index->words[id] = copy;
+    if (2 * (size_t)index->count > index->capacity)
+    {
+        if (grow_slots(index) == EXIT_FAILURE)
+        {
+            if (reused)
+            {
+                index->free_count++;
+            }
+            else
+            {
+                index->count--;
+            }
+            index->words[id] = NULL;
+            free(copy);
+            return WORD_NOT_FOUND;
+        }
+        return id;
+    }
+    index->slots[slot] = id;
+    return id;
+}
+
+int word_index_find(const WordIndex *index, const char *word,
+                    const size_t length)
+{
+    return index->slots[find_slot(index, word, length)];
+}
+
+int word_index_remove(WordIndex *index, const int id)
+{
+    if (index->free_capacity < index->words_capacity)
+    {
+        int *temp = realloc(index->free_ids,
+                            index->words_capacity * sizeof(int));
+        if (temp == NULL)
+        {
+            return EXIT_FAILURE;
+        }
+        index->free_ids = temp;
+        index->free_capacity = index->words_capacity;
+    }
+    const char *word = index->words[id];
+    const size_t mask = index->capacity - 1;
+    size_t slot = find_slot(index, word, strlen(word));
+    index->slots[slot] = WORD_NOT_FOUND;
+    // shift back the words probed past the emptied slot, so their lookups
+    // don't stop at it
+    for (size_t next = (slot + 1) & mask; index->slots[next] != WORD_NOT_FOUND;
+         next = (next + 1) & mask)
+    {
+        const char *moved = index->words[index->slots[next]];
+        const size_t home = hash_word(moved, strlen(moved)) & mask;
+        if (((next - home) & mask) >= ((next - slot) & mask))
+        {
+            index->slots[slot] = index->slots[next];
+            index->slots[next] = WORD_NOT_FOUND;
+            slot = next;
+        }
+    }
+    free(index->words[id]);
+    index->words[id] = NULL;
+    index->free_ids[index->free_count++] = id;
+    return EXIT_SUCCESS;
+}
+
+void free_word_index(WordIndex *index)
+{
+    for (int id = 0; id < index->count; id++)
+    {
+        free(index->words[id]);
+    }
+    free(index->words);
+    free(index->slots);
+    free(index->free_ids);
+    *index = (WordIndex){NULL, 0, NULL, 0, 0, NULL, 0, 0};
+}
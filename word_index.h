@@ -0,0 +1,67 @@
+#ifndef _WORD_INDEX_H_
+#define _WORD_INDEX_H_
+
+#include <stddef.h> // For size_t
+
+#define WORD_NOT_FOUND (-1)
+
+/**
+ * Hash table from words to consecutive ids 0..count-1, in the order the
+ * words were added. Words are looked up by pointer and length, so they
+ * don't have to be null terminated. The ids of removed words are given to
+ * the next words added.
+ */
+typedef struct WordIndex {
+    int *slots;      // id of the word in every slot, or WORD_NOT_FOUND
+    size_t capacity; // number of slots, a power of two
+    char **words;    // words[id], null terminated copies owned by the index,
+                     // NULL for removed ids
+    int count;       // ids handed out, including removed ones
+    int words_capacity;
+    int *free_ids;   // removed ids waiting to be reused
+    int free_count;
+    int free_capacity;
+} WordIndex;
+
+/**
+ * Initialize an empty index.
+ * @param index index to initialize
+ * @param expected number of words expected, the index grows past it
+ * @return EXIT_SUCCESS or EXIT_FAILURE in case of allocation error
+ */
+int init_word_index(WordIndex *index, size_t expected);
+
+/**
+ * Get the id of a word, adding it to the index if it's not there yet.
+ * @param index
+ * @param word start of the word
+ * @param length length of the word
+ * @return id of the word, or WORD_NOT_FOUND in case of allocation error
+ */
+int word_index_add(WordIndex *index, const char *word, size_t length);
+
+/**
+ * Get the id of a word.
+ * @param index
+ * @param word start of the word
+ * @param length length of the word
+ * @return id of the word, or WORD_NOT_FOUND if it's not in the index
+ */
+int word_index_find(const WordIndex *index, const char *word, size_t length);
+
+/**
+ * Remove a word from the index. Its id is reused by a later word.
+ * @param index
+ * @param id id of a word in the index
+ * @return EXIT_SUCCESS or EXIT_FAILURE in case of allocation error, in which
+ * case the word stays in the index
+ */
+int word_index_remove(WordIndex *index, int id);
+
+/**
+ * Free index and all the words it holds.
+ * @param index
+ */
+void free_word_index(WordIndex *index);
+
+#endif //_WORD_INDEX_H_